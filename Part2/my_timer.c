@@ -1,38 +1,168 @@
-#include <linux/init.h> 
-#include <linux/module.h> 
-#include <linux/kernel.h> 
-#include <linux/proc_fs.h> 
-#include <linux/uaccess.h> 
-#include <linux/ktime.h> 
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/proc_fs.h>
+#include <linux/uaccess.h>
+#include <linux/ktime.h>
+#include <linux/hrtimer.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/io.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/version.h>
 
-MODULE_LICENSE("GPL"); 
-MODULE_AUTHOR("group19"); 
-MODULE_DESCRIPTION("Obtain the current time and store it in the module."); 
-MODULE_VERSION("1.0"); 
+#include "my_timer.h"
 
-#define ENTRY_NAME "timer" 
-#define PERMS 0666 
-#define PARENT NULL 
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("group19");
+MODULE_DESCRIPTION("Obtain the current time and store it in the module.");
+MODULE_VERSION("1.0");
 
-#define BUF_LEN 200 
+#define ENTRY_NAME "timer"
+#define PERMS 0666
+#define PARENT NULL
 
-static struct proc_dir_entry* proc_entry; 
-static int procfs_buf_len; 
-static struct timespec64 prev_time; 
+#define BUF_LEN 200
 
-// Function that is called when the /proc/timer is read
-static ssize_t procfile_read(struct file* file, char* ubuf, size_t count, loff_t *ppos)
+static unsigned int tick_us = 1000;
+module_param(tick_us, uint, 0444);
+MODULE_PARM_DESC(tick_us, "How often the mmap clock page is refreshed while mapped, in microseconds");
+
+// State kept for each open of /proc/timer in file->private_data
+struct timer_file {
+    struct mutex lock;        // Serializes reads sharing this open file
+    struct timer_page *page;  // This file's last read, mmap page 1
+    bool mapped;              // Counted in mapped_files
+    char buf[BUF_LEN];        // Text of the current reading
+    size_t len;
+};
+
+static struct proc_dir_entry* proc_entry;
+static struct timer_page *clock_page; // Current time, mmap page 0
+static struct hrtimer clock_timer;
+
+// Open files with a mapping; clock_timer only runs while this is nonzero
+static DEFINE_MUTEX(mapped_files_lock);
+static unsigned int mapped_files;
+
+// Serializes writers of clock_page (clock_tick() runs in hard irq context)
+// and guards prev_time: the last read through any open file, so a fresh
+// open (e.g. each cat) still reports the time elapsed since the previous call
+static DEFINE_SPINLOCK(clock_lock);
+static struct timespec64 prev_time;
+
+// Write a timestamp into a page using the seqcount protocol in my_timer.h.
+// Callers hold clock_lock, or tf->lock for a file page
+static void timer_page_publish(struct timer_page *page, const struct timespec64 *time)
+{
+    WRITE_ONCE(page->seq, page->seq + 1); // Odd: update in progress
+    smp_wmb();
+    WRITE_ONCE(page->tv_sec, time->tv_sec);
+    WRITE_ONCE(page->tv_nsec, time->tv_nsec);
+    smp_wmb();
+    WRITE_ONCE(page->seq, page->seq + 1); // Even: update complete
+}
+
+// Publish the current time to the clock page
+static void clock_page_refresh(void)
+{
+    struct timespec64 time;
+    unsigned long flags;
+
+    spin_lock_irqsave(&clock_lock, flags);
+    ktime_get_real_ts64(&time);
+    timer_page_publish(clock_page, &time);
+    spin_unlock_irqrestore(&clock_lock, flags);
+}
+
+// Refresh the clock page while something has it mapped
+static enum hrtimer_restart clock_tick(struct hrtimer *timer)
+{
+    clock_page_refresh();
+    hrtimer_forward_now(timer, ns_to_ktime((u64)tick_us * NSEC_PER_USEC));
+    return HRTIMER_RESTART;
+}
+
+// Function that is called when /proc/timer is opened
+static int procfile_open(struct inode *inode, struct file *file)
+{
+    struct timer_file *tf;
+
+    tf = kzalloc(sizeof(*tf), GFP_KERNEL);
+    if (!tf)
+        return -ENOMEM;
+
+    tf->page = (struct timer_page *)get_zeroed_page(GFP_KERNEL);
+    if (!tf->page) {
+        kfree(tf);
+        return -ENOMEM;
+    }
+    tf->page->version = TIMER_PAGE_VERSION;
+    mutex_init(&tf->lock);
+
+    // Mappings of clock_page can outlive proc_remove(), so keep the module
+    // loaded until the last file (and therefore mapping) is released
+    if (!try_module_get(THIS_MODULE)) {
+        free_page((unsigned long)tf->page);
+        kfree(tf);
+        return -ENODEV;
+    }
+
+    file->private_data = tf;
+    return 0;
+}
+
+// Function that is called when the last reference to an open file goes away
+static int procfile_release(struct inode *inode, struct file *file)
+{
+    struct timer_file *tf = file->private_data;
+
+    // A mapping holds a reference to the file, so this is also the end of
+    // this file's mappings
+    if (tf->mapped) {
+        mutex_lock(&mapped_files_lock);
+        if (--mapped_files == 0)
+            hrtimer_cancel(&clock_timer);
+        mutex_unlock(&mapped_files_lock);
+    }
+
+    mutex_destroy(&tf->lock);
+    free_page((unsigned long)tf->page);
+    kfree(tf);
+    module_put(THIS_MODULE);
+    return 0;
+}
+
+// Format the current time, and the time since the last read, into tf->buf
+static void render_reading(struct timer_file *tf)
 {
     struct timespec64 time; // Variable to store the current time
-    char buf[BUF_LEN]; // Buffer to store the string to be copied to user space
+    struct timespec64 prev; // Previous read on this file, or on any file
     long long elapsed_sec, elapsed_nsec; // Variables to store elapsed time
+    unsigned long flags;
 
+    spin_lock_irqsave(&clock_lock, flags);
     ktime_get_real_ts64(&time); // Get the current real time
+    if (tf->page->tv_sec != 0 || tf->page->tv_nsec != 0) {
+        prev.tv_sec = tf->page->tv_sec;
+        prev.tv_nsec = tf->page->tv_nsec;
+    } else {
+        prev = prev_time;
+    }
+    prev_time = time; // Update the previous time for the next open
+
+    // Publish this read so mmap clients can compute elapsed time themselves.
+    // The clock page gets the same time first, so a client that reads its
+    // file page before the clock page never sees the clock behind it
+    timer_page_publish(clock_page, &time);
+    timer_page_publish(tf->page, &time);
+    spin_unlock_irqrestore(&clock_lock, flags);
 
     // Calculate elapsed time if this is not the first read
-    if (prev_time.tv_sec != 0 || prev_time.tv_nsec != 0) {
-        elapsed_sec = time.tv_sec - prev_time.tv_sec;
-        elapsed_nsec = time.tv_nsec - prev_time.tv_nsec;
+    if (prev.tv_sec != 0 || prev.tv_nsec != 0) {
+        elapsed_sec = time.tv_sec - prev.tv_sec;
+        elapsed_nsec = time.tv_nsec - prev.tv_nsec;
 
         // Adjust for negative nanosecond difference
         if (elapsed_nsec < 0) {
@@ -41,55 +171,126 @@ static ssize_t procfile_read(struct file* file, char* ubuf, size_t count, loff_t
         }
 
         // Format the time and elapsed time into the buffer
-        sprintf(buf, "Current time: %lld.%09ld\nElapsed time since last call: %lld.%09lld seconds\n",
+        tf->len = scnprintf(tf->buf, BUF_LEN,
+                "Current time: %lld.%09ld\nElapsed time since last call: %lld.%09lld seconds\n",
                 (long long)time.tv_sec, time.tv_nsec, elapsed_sec, elapsed_nsec);
     } else {
         // If this is the first read, only show the current time
-        sprintf(buf, "Current time: %lld.%09ld\n",
+        tf->len = scnprintf(tf->buf, BUF_LEN, "Current time: %lld.%09ld\n",
                 (long long)time.tv_sec, time.tv_nsec);
     }
+}
 
-    // Update the previous time for the next read
-    prev_time = time;
-
-    procfs_buf_len = strlen(buf); // Update the buffer length
+// Function that is called when the /proc/timer is read
+static ssize_t procfile_read(struct file* file, char __user *ubuf, size_t count, loff_t *ppos)
+{
+    struct timer_file *tf = file->private_data;
+    ssize_t ret;
 
-    // Handle partial reads
-    if (*ppos > 0 || count < procfs_buf_len)
-        return 0;
+    mutex_lock(&tf->lock);
 
-    // Copy buffer to user space
-    if (copy_to_user(ubuf, buf, procfs_buf_len))
-        return -EFAULT;
+    // Take a new reading at the start of the file; partial reads after that
+    // continue through the same text
+    if (*ppos == 0)
+        render_reading(tf);
 
-    *ppos = procfs_buf_len; // Update the position for partial reads
+    ret = simple_read_from_buffer(ubuf, count, ppos, tf->buf, tf->len);
 
-    return procfs_buf_len; // Return the length of the buffer
+    mutex_unlock(&tf->lock);
+    return ret;
 }
 
 // Function that is called when the /proc/timer is written to
-static ssize_t procfile_write(struct file* file, const char* ubuf, size_t count, loff_t* ppos) {
+static ssize_t procfile_write(struct file* file, const char __user *ubuf, size_t count, loff_t* ppos) {
     printk(KERN_INFO "proc_write\n"); // Log that a write attempt was made
     return -EPERM; // Return an error code indicating operation not permitted
 }
 
+// Map the clock page and this file's page read-only (see my_timer.h)
+static int procfile_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    struct timer_file *tf = file->private_data;
+    struct timer_page *pages[TIMER_NUM_PAGES] = {
+        [TIMER_CLOCK_PAGE] = clock_page,
+        [TIMER_FILE_PAGE] = tf->page,
+    };
+    unsigned long num_pages = vma_pages(vma);
+    int ret;
+
+    if (vma->vm_flags & VM_WRITE)
+        return -EPERM;
+    if (vma->vm_pgoff >= TIMER_NUM_PAGES || num_pages > TIMER_NUM_PAGES - vma->vm_pgoff)
+        return -EINVAL;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+    vm_flags_clear(vma, VM_MAYWRITE);
+#else
+    vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+    for (unsigned long i = 0; i < num_pages; i++) {
+        ret = remap_pfn_range(vma, vma->vm_start + i * PAGE_SIZE,
+                              virt_to_phys(pages[vma->vm_pgoff + i]) >> PAGE_SHIFT,
+                              PAGE_SIZE, vma->vm_page_prot);
+        if (ret)
+            return ret;
+    }
+
+    // Start refreshing the clock page for the first mapped file; refresh it
+    // now so the new mapping does not start out up to a tick behind
+    mutex_lock(&mapped_files_lock);
+    if (!tf->mapped) {
+        tf->mapped = true;
+        if (mapped_files++ == 0) {
+            clock_page_refresh();
+            hrtimer_start(&clock_timer, ns_to_ktime((u64)tick_us * NSEC_PER_USEC),
+                          HRTIMER_MODE_REL);
+        }
+    }
+    mutex_unlock(&mapped_files_lock);
+
+    return 0;
+}
+
 // Define file operations for the proc file
 static const struct proc_ops procfile_fops = {
+    .proc_open = procfile_open,
+    .proc_release = procfile_release,
     .proc_read = procfile_read,
     .proc_write = procfile_write,
+    .proc_mmap = procfile_mmap,
 };
 
 // Function called when module is loaded
 static int __init my_timer_init(void){
+    if (tick_us == 0)
+        return -EINVAL;
+
+    clock_page = (struct timer_page *)get_zeroed_page(GFP_KERNEL);
+    if (clock_page == NULL)
+        return -ENOMEM;
+    clock_page->version = TIMER_PAGE_VERSION;
+    clock_page_refresh();
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+    hrtimer_setup(&clock_timer, clock_tick, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+#else
+    hrtimer_init(&clock_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    clock_timer.function = clock_tick;
+#endif
+
     proc_entry = proc_create(ENTRY_NAME, PERMS, PARENT, &procfile_fops); // Create the proc entry
-    if (proc_entry == NULL)
+    if (proc_entry == NULL) {
+        free_page((unsigned long)clock_page);
         return -ENOMEM; // Return an error if creation failed
+    }
     return 0; // Return 0 on successful module initialization
 }
 
 // Function called when module is unloaded
 static void __exit my_timer_exit(void){
     proc_remove(proc_entry); // Remove the proc entry
+    free_page((unsigned long)clock_page);
 }
 
 // Register module entry and exit points
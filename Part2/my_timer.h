@@ -0,0 +1,55 @@
+#ifndef MY_TIMER_H
+#define MY_TIMER_H
+
+#include <linux/types.h>
+
+// Layout of the pages exported by mmap() on /proc/timer. Shared by the
+// module and userspace clients.
+//
+// Page 0 (offset 0) is the clock page: the current real time, refreshed by
+// the module every tick_us microseconds while any open file has a mapping,
+// and on every read of /proc/timer. It can lag the real time by up to
+// tick_us, so elapsed times computed from it have that resolution.
+// Page 1 (offset = page size) belongs to the open file: the time of that
+// file's last read of /proc/timer, zero until the first read.
+//
+// A read stamps the clock page before the file page with the same time, so
+// read the file page first and the clock page second to get an elapsed
+// time that is never negative (unless the system clock is set back).
+//
+// Both are published with a sequence count: seq is odd while the module is
+// writing, so readers retry until they see the same even seq on both sides
+// of their copy (see timer_page_read()).
+
+#define TIMER_PAGE_VERSION 1
+#define TIMER_CLOCK_PAGE 0
+#define TIMER_FILE_PAGE 1
+#define TIMER_NUM_PAGES 2
+
+struct timer_page {
+    __u32 seq;     // Odd while an update is in progress
+    __u32 version; // TIMER_PAGE_VERSION
+    __s64 tv_sec;
+    __s64 tv_nsec;
+};
+
+#ifndef __KERNEL__
+#include <time.h>
+
+// Copy a consistent timestamp out of a mapped timer page without a syscall
+static inline void timer_page_read(const volatile struct timer_page *page, struct timespec *ts)
+{
+    __u32 seq;
+
+    do {
+        while ((seq = page->seq) & 1)
+            ; // Writer in progress
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        ts->tv_sec = page->tv_sec;
+        ts->tv_nsec = page->tv_nsec;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (page->seq != seq);
+}
+#endif
+
+#endif
@@ -6,26 +6,95 @@
 #include <linux/mutex.h>
 #include <linux/delay.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/atomic.h>
+#include <linux/uaccess.h>
+#include <linux/jump_label.h>
+#include <linux/overflow.h>
+
+#include "elevator_snapshot.h"
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Group 19");
 MODULE_DESCRIPTION("Elevator kernel module");
 
 #define ENTRY_NAME "elevator"
+#define STATS_ENTRY_NAME "elevator_stats"
+#define BIN_ENTRY_NAME "elevator_bin"
+// Both text proc files grow with the floor count (make FLOORS=n); output
+// past the end is truncated rather than written past the buffer
+#define PROC_BUF_LEN (4096 + MAX_FLOORS * 128)
+#define STATS_BUF_LEN (4096 + MAX_FLOORS * 96)
 #define PERMS 0644
 #define PARENT NULL
 
 static struct proc_dir_entry* elevator_entry;
+static struct proc_dir_entry* stats_entry;
+static struct proc_dir_entry* bin_entry;
 static struct mutex elevator_mutex; 
 static struct task_struct *elevator_thread;
 
+// Overridable (make FLOORS=n) so the microbenchmarks can run large buildings
+#ifndef MAX_FLOORS
 #define MAX_FLOORS 5
+#endif
 #define MAX_PASSENGER_TYPES 4
 #define MAX_PASSENGERS 5
 #define MAX_WEIGHT 7
 #define DECIMAL 5
 
 typedef enum {OFFLINE, IDLE, LOADING, UP, DOWN} ElevatorState;
+// /proc/elevator_bin exports these values as they are
+static_assert(OFFLINE == ELEVATOR_SNAPSHOT_OFFLINE && IDLE == ELEVATOR_SNAPSHOT_IDLE
+              && LOADING == ELEVATOR_SNAPSHOT_LOADING && UP == ELEVATOR_SNAPSHOT_UP
+              && DOWN == ELEVATOR_SNAPSHOT_DOWN);
+
+// Profiling counters for one mutex. Every field is only written while the
+// mutex it describes is held (reset_stats() included), so no extra locking
+// is needed
+typedef struct lock_stats {
+    u64 acquisitions;
+    u64 contended;   // Acquisitions that found the mutex already taken
+    u64 wait_ns;     // Time spent waiting to acquire
+    u64 hold_ns;     // Time spent holding
+    u64 acquired_at; // When the current holder got the mutex, 0 if untracked
+} LockStats;
+
+// Hot-path phases timed by the profiling counters
+typedef enum {
+    PHASE_UNLOAD,
+    PHASE_LOAD,
+    PHASE_DECIDE,
+    PHASE_SHOULD_STOP,
+    PHASE_RENDER,
+    PHASE_RENDER_BIN,
+    NUM_PHASES
+} Phase;
+
+static const char *phase_names[NUM_PHASES] = {
+    "unload_passengers",
+    "load_passengers",
+    "decide_next_action",
+    "should_stop",
+    "proc render",
+    "proc render bin",
+};
+
+typedef struct phase_stats {
+    atomic64_t calls;
+    atomic64_t total_ns;
+    atomic64_t max_ns;
+} PhaseStats;
+
+// Profiling is off by default and costs a patched-out jump per site until
+// enabled with stats=1 at load time or by writing 1 to /proc/elevator_stats
+static DEFINE_STATIC_KEY_FALSE(elevator_stats_key);
+static bool stats;
+module_param(stats, bool, 0444);
+MODULE_PARM_DESC(stats, "Collect lock and phase profiling counters from load");
+
+static LockStats elevator_lock_stats;
+static PhaseStats phase_stats[NUM_PHASES];
 
 typedef struct passenger {
     char type; // P, L, B, V
@@ -38,12 +107,17 @@ typedef struct passenger {
 typedef struct floor {
     int floor_number;
     int num_passengers_waiting;
-    struct list_head passengers;
+    int num_waiting_up;   // Riders queued in up_passengers
+    int num_waiting_down; // Riders queued in down_passengers
+    struct list_head up_passengers;
+    struct list_head down_passengers;
     struct mutex floor_mutex;
+    LockStats lock_stats;
 } Floor;
 
 typedef struct elevator {
     ElevatorState state;
+    ElevatorState direction; // UP or DOWN, kept while LOADING
     int current_floor;
     int total_weight;
     int passenger_count;
@@ -54,6 +128,7 @@ typedef struct elevator {
 
 static Elevator elevator = {
     .state = OFFLINE,
+    .direction = UP,
     .current_floor = 1,
     .total_weight = 0,
     .passenger_count = 0,
@@ -74,20 +149,100 @@ static int stop_elevator(void);
 static int issue_request(int,int,int);
 static bool should_stop(int);
 static void decide_next_action(void);
+static bool has_demand_beyond(int, ElevatorState);
+
+//lock a mutex, counting acquisitions, contention and wait time if profiling
+static void profiled_lock(struct mutex *lock, LockStats *lock_stats) {
+    u64 start;
+
+    if (!static_branch_unlikely(&elevator_stats_key)) {
+        mutex_lock(lock);
+        return;
+    }
+
+    start = ktime_get_ns();
+    if (!mutex_trylock(lock)) {
+        mutex_lock(lock);
+        lock_stats->contended++;
+    }
+    lock_stats->acquired_at = ktime_get_ns();
+    lock_stats->acquisitions++;
+    lock_stats->wait_ns += lock_stats->acquired_at - start;
+}
+
+//unlock a mutex, adding to its hold time if the acquisition was tracked
+static void profiled_unlock(struct mutex *lock, LockStats *lock_stats) {
+    if (static_branch_unlikely(&elevator_stats_key) && lock_stats->acquired_at) {
+        lock_stats->hold_ns += ktime_get_ns() - lock_stats->acquired_at;
+    }
+    // Cleared even with profiling off, so a timestamp left by a tracked
+    // acquisition can never be charged to a later untracked one
+    lock_stats->acquired_at = 0;
+    mutex_unlock(lock);
+}
+
+//timestamp the start of a phase, 0 when profiling is off
+static u64 phase_begin(void) {
+    if (!static_branch_unlikely(&elevator_stats_key)) {
+        return 0;
+    }
+    return ktime_get_ns();
+}
+
+//account the time since phase_begin() to a phase
+static void phase_end(Phase phase, u64 start) {
+    PhaseStats *ps = &phase_stats[phase];
+    u64 elapsed;
+
+    if (!static_branch_unlikely(&elevator_stats_key) || !start) {
+        return;
+    }
+
+    elapsed = ktime_get_ns() - start;
+    atomic64_inc(&ps->calls);
+    atomic64_add(elapsed, &ps->total_ns);
+    // Racing renders may lose a max update, which is fine for profiling
+    if (elapsed > atomic64_read(&ps->max_ns)) {
+        atomic64_set(&ps->max_ns, elapsed);
+    }
+}
+
+//the direction opposite to the one passed in
+static ElevatorState reverse_direction(ElevatorState direction) {
+    return (direction == UP) ? DOWN : UP;
+}
+
+//hall call queue on a floor for riders travelling in the given direction
+static struct list_head *floor_queue(Floor *floor, ElevatorState direction) {
+    return (direction == UP) ? &floor->up_passengers : &floor->down_passengers;
+}
+
+//number of riders waiting on a floor to travel in the given direction
+static int floor_waiting(Floor *floor, ElevatorState direction) {
+    return (direction == UP) ? floor->num_waiting_up : floor->num_waiting_down;
+}
+
+#ifndef MODULE
+// Built in without the syscall patch (kunit.py under UML) nothing defines
+// the stubs; a patched kernel's definitions in syscalls.c take precedence
+int (*STUB_start_elevator)(void) __weak;
+int (*STUB_issue_request)(int, int, int) __weak;
+int (*STUB_stop_elevator)(void) __weak;
+#endif
 
 //links system calls to module
 extern int (*STUB_start_elevator)(void);
 int start_elevator(void) {
     //unlock the mutex every time elevator data must be accessed
-    mutex_lock(&elevator_mutex);
+    profiled_lock(&elevator_mutex, &elevator_lock_stats);
     if (elevator.state != OFFLINE) {
-        mutex_unlock(&elevator_mutex);
+        profiled_unlock(&elevator_mutex, &elevator_lock_stats);
         pr_err("Elevator cannot be started. It is not in the OFFLINE state.\n");
         return -EINVAL; 
     }
     elevator.state = IDLE;
     pr_info("Elevator started successfully.\n");
-    mutex_unlock(&elevator_mutex);
+    profiled_unlock(&elevator_mutex, &elevator_lock_stats);
     return 0;
 }
 
@@ -96,28 +251,28 @@ int stop_elevator(void) {
 
     //remove all passengers from elevator when stop is called
     Passenger *passenger, *temp;
-    mutex_lock(&elevator_mutex);
+    profiled_lock(&elevator_mutex, &elevator_lock_stats);
 
     // Check if the elevator is already offline.
     if (elevator.state == OFFLINE) {
-        mutex_unlock(&elevator_mutex);
+        profiled_unlock(&elevator_mutex, &elevator_lock_stats);
         return 0; 
     }
 
     elevator.state = OFFLINE;
-    mutex_unlock(&elevator_mutex);
+    profiled_unlock(&elevator_mutex, &elevator_lock_stats);
 
     if (elevator_thread) {
         kthread_stop(elevator_thread);
         elevator_thread = NULL; 
     }
 
-    mutex_lock(&elevator_mutex);
+    profiled_lock(&elevator_mutex, &elevator_lock_stats);
     list_for_each_entry_safe(passenger, temp, &elevator.passengers, list) {
         list_del(&passenger->list); 
         kfree(passenger); 
     }
-    mutex_unlock(&elevator_mutex);
+    profiled_unlock(&elevator_mutex, &elevator_lock_stats);
 
     pr_info("Elevator stopped successfully.\n");
 
@@ -164,23 +319,34 @@ int issue_request(int start, int dest, int type) {
         kfree(new_passenger);
         return -EINVAL;
     }
-    //add the new passengers to the list of passengers waiting on each floor
-    mutex_lock(&floors[start - 1].floor_mutex);
-    list_add_tail(&new_passenger->list, &floors[start - 1].passengers);
-    floors[start - 1].num_passengers_waiting++;
-    mutex_unlock(&floors[start - 1].floor_mutex);
+    //queue the passenger on the start floor by the direction they travel
+    ElevatorState direction = (dest < start) ? DOWN : UP;
+    Floor *start_floor = &floors[start - 1];
+
+    profiled_lock(&start_floor->floor_mutex, &start_floor->lock_stats);
+    list_add_tail(&new_passenger->list, floor_queue(start_floor, direction));
+    if (direction == UP) {
+        start_floor->num_waiting_up++;
+    } else {
+        start_floor->num_waiting_down++;
+    }
+    start_floor->num_passengers_waiting++;
+    profiled_unlock(&start_floor->floor_mutex, &start_floor->lock_stats);
 
-    mutex_lock(&elevator_mutex);
+    profiled_lock(&elevator_mutex, &elevator_lock_stats);
     if (elevator.state == IDLE) {
         if (elevator.current_floor < start) {
             elevator.state = UP;
+            elevator.direction = UP;
         } else if (elevator.current_floor > start) {
             elevator.state = DOWN;
+            elevator.direction = DOWN;
         } else {
             elevator.state = LOADING;
+            elevator.direction = direction;
         }
     }
-    mutex_unlock(&elevator_mutex);
+    profiled_unlock(&elevator_mutex, &elevator_lock_stats);
     return 0;
 }
 
@@ -220,58 +386,54 @@ static int elevator_movement(void *data) {
     return 0;
 }
 
-//function to decide where the elevator goes next
-static void decide_next_action(void) {
-
-    Passenger *passenger, *temp;
-
-    bool upDirectionHasPassengers = false;
-    bool downDirectionHasPassengers = false;
-    bool upDirectionHasDest = false;
-    bool downDirectionHasDest = false;
+//check for riders to drop off or pick up past the given floor in a direction
+static bool has_demand_beyond(int floor, ElevatorState direction) {
+    Passenger *passenger;
 
-    //look through the list of passengers in the elevator and determine who needs to go up and down
-    list_for_each_entry_safe(passenger, temp, &elevator.passengers, list) {
-        if (passenger->destination_floor > elevator.current_floor) {
-            upDirectionHasDest = true;
+    list_for_each_entry(passenger, &elevator.passengers, list) {
+        if ((direction == UP && passenger->destination_floor > floor)
+            || (direction == DOWN && passenger->destination_floor < floor)) {
+            return true;
         }
     }
 
-    list_for_each_entry_safe(passenger, temp, &elevator.passengers, list) {
-        if (passenger->destination_floor < elevator.current_floor) {
-            downDirectionHasDest = true;
+    // floor is 1-indexed, so floors[floor] is the floor above and
+    // floors[floor - 2] the floor below
+    if (direction == UP) {
+        for (int i = floor; i < MAX_FLOORS; i++) {
+            if (floors[i].num_passengers_waiting > 0) {
+                return true;
+            }
         }
-    }
-
-    // Check for passengers above current floor needing to go up or down
-    for (int i = elevator.current_floor; i < MAX_FLOORS; i++) {
-        if (floors[i].num_passengers_waiting > 0) {
-            upDirectionHasPassengers = true;
-            break;
+    } else {
+        for (int i = floor - 2; i >= 0; i--) {
+            if (floors[i].num_passengers_waiting > 0) {
+                return true;
+            }
         }
     }
 
-    // Check for passengers below current floor needing to go up or down
-    // i starts from current_floor - 2 because array indexing starts at 0
-    for (int i = elevator.current_floor - 2; i >= 0; i--) { 
-        if (floors[i].num_passengers_waiting > 0) {
-            downDirectionHasPassengers = true;
-            break;
-        }
-    }
+    return false;
+}
 
-    // Determine next state based on where passengers are waiting
-    if(upDirectionHasDest) {
-	elevator.state = UP;
-    } else if (downDirectionHasDest) {
-	elevator.state = DOWN;
-    } else if (upDirectionHasPassengers) {
-        elevator.state = UP;
-    } else if (downDirectionHasPassengers) {
-        elevator.state = DOWN;
+//function to decide where the elevator goes next
+static void decide_next_action(void) {
+    ElevatorState ahead = elevator.direction;
+    ElevatorState behind = reverse_direction(elevator.direction);
+    u64 start = phase_begin();
+
+    // Keep sweeping in the current direction while anyone still needs it,
+    // and only turn around once the run is exhausted
+    if (has_demand_beyond(elevator.current_floor, ahead)) {
+        elevator.state = ahead;
+    } else if (has_demand_beyond(elevator.current_floor, behind)) {
+        elevator.direction = behind;
+        elevator.state = behind;
     } else {
         elevator.state = IDLE; // No passengers waiting, go idle
     }
+
+    phase_end(PHASE_DECIDE, start);
 }
 
 //get number of passengers currently waiting for the elevator
@@ -279,9 +441,9 @@ static int get_num_waiting(void) {
     int waiting = 0;
 
     for(int i = 0; i < MAX_FLOORS; i++) {
-	mutex_lock(&floors[i].floor_mutex);
+	profiled_lock(&floors[i].floor_mutex, &floors[i].lock_stats);
         waiting += floors[i].num_passengers_waiting;
-	mutex_unlock(&floors[i].floor_mutex);
+	profiled_unlock(&floors[i].floor_mutex, &floors[i].lock_stats);
     }
 
     return waiting;
@@ -290,45 +452,70 @@ static int get_num_waiting(void) {
 //call this in the elevator movement function
 static void unload_passengers(void) {
     Passenger *passenger, *temp;
+    u64 start = phase_begin();
+
     list_for_each_entry_safe(passenger, temp, &elevator.passengers, list) {
         if (passenger->destination_floor == elevator.current_floor) {
-            mutex_lock(&elevator_mutex);
+            profiled_lock(&elevator_mutex, &elevator_lock_stats);
             elevator.total_weight -= passenger->weight;
             elevator.passenger_count--;
             elevator.total_serviced++;
             list_del(&passenger->list);
             kfree(passenger);
-            mutex_unlock(&elevator_mutex);
+            profiled_unlock(&elevator_mutex, &elevator_lock_stats);
         }
     }
+
+    phase_end(PHASE_UNLOAD, start);
 }
 
 //call in elevator movement function
 static void load_passengers(void) {
     Passenger *passenger, *temp;
     Floor *current_floor = &floors[elevator.current_floor - 1];
+    struct list_head *queue;
+    u64 start = phase_begin();
+
+    // At the end of a run nobody is left ahead, so turn around and board
+    // the riders waiting to travel the other way
+    if (floor_waiting(current_floor, elevator.direction) == 0
+        && !has_demand_beyond(elevator.current_floor, elevator.direction)) {
+        elevator.direction = reverse_direction(elevator.direction);
+    }
+
+    profiled_lock(&elevator_mutex, &elevator_lock_stats);
+    profiled_lock(&current_floor->floor_mutex, &current_floor->lock_stats);
+    queue = floor_queue(current_floor, elevator.direction);
 
-    // Iterate through the passengers waiting on the current floor
-    list_for_each_entry_safe(passenger, temp, &current_floor->passengers, list) {
+    // Only board riders heading the way the elevator is going
+    list_for_each_entry_safe(passenger, temp, queue, list) {
         // Check if elevator can accommodate the passenger
         if (elevator.total_weight + passenger->weight <= MAX_WEIGHT 
 	    && elevator.passenger_count < MAX_PASSENGERS) {
-            mutex_lock(&elevator_mutex);
+            if (elevator.direction == UP) {
+                current_floor->num_waiting_up--;
+            } else {
+                current_floor->num_waiting_down--;
+            }
             current_floor->num_passengers_waiting--;
-            list_del(&passenger->list);
-            list_add_tail(&passenger->list, &elevator.passengers);
+            list_move_tail(&passenger->list, &elevator.passengers);
             elevator.total_weight += passenger->weight;
             elevator.passenger_count++;
-            mutex_unlock(&elevator_mutex);
         } else {
             break; // Elevator is full or overweight
         }
     }
+
+    profiled_unlock(&current_floor->floor_mutex, &current_floor->lock_stats);
+    profiled_unlock(&elevator_mutex, &elevator_lock_stats);
+
+    phase_end(PHASE_LOAD, start);
 }
 
 //increment the current floor
 static void move_up(void) {
     elevator.current_floor++;
+    elevator.direction = UP;
     if(should_stop(elevator.current_floor)) {
 	elevator.state = LOADING;
     } 
@@ -337,13 +524,14 @@ static void move_up(void) {
 //decrement the current floor
 static void move_down(void) {
     elevator.current_floor--;
+    elevator.direction = DOWN;
     if(should_stop(elevator.current_floor)) {
         elevator.state = LOADING;
     }
 }
 
-//check if the elevator needs to stop on the floor passed in
-static bool should_stop(int floor) {
+//stop decision for should_stop(), kept separate so it can be timed
+static bool floor_needs_stop(int floor) {
     Floor *current_floor = &floors[floor - 1];
     Passenger *passenger;
     
@@ -354,74 +542,96 @@ static bool should_stop(int floor) {
         }
     }
     
-    // Check if there are passengers waiting at this floor
-    if (current_floor->num_passengers_waiting > 0) {
+    // Check if there are passengers waiting here to go the same way
+    if (floor_waiting(current_floor, elevator.direction) > 0) {
+        return true;
+    }
+
+    // Riders waiting to go the other way are picked up on the way back,
+    // unless this is the last floor with anything to do in this direction
+    if (floor_waiting(current_floor, reverse_direction(elevator.direction)) > 0
+        && !has_demand_beyond(floor, elevator.direction)) {
         return true;
     }
     
     return false;
 }
 
+//check if the elevator needs to stop on the floor passed in
+static bool should_stop(int floor) {
+    u64 start = phase_begin();
+    bool stop = floor_needs_stop(floor);
+
+    phase_end(PHASE_SHOULD_STOP, start);
+    return stop;
+}
+
 //prints the data to the proc file
 static ssize_t elevator_read(struct file *file, char __user *ubuf, size_t count, loff_t *ppos) {
     char *buf;
     ssize_t len = 0;
     Passenger *passenger;
+    u64 start;
 
-    buf = kmalloc(4096, GFP_KERNEL); // Dynamically allocate memory
+    buf = kmalloc(PROC_BUF_LEN, GFP_KERNEL); // Dynamically allocate memory
     if (!buf) {
         return -ENOMEM; // Memory allocation failed
     }
+    start = phase_begin();
 
-    mutex_lock(&elevator_mutex);
-    len += sprintf(buf + len, "Elevator state: ");
+    profiled_lock(&elevator_mutex, &elevator_lock_stats);
+    len += scnprintf(buf + len, PROC_BUF_LEN - len, "Elevator state: ");
     switch (elevator.state) {
         case OFFLINE:
-            len += sprintf(buf + len, "OFFLINE\n");
+            len += scnprintf(buf + len, PROC_BUF_LEN - len, "OFFLINE\n");
             break;
         case IDLE:
-            len += sprintf(buf + len, "IDLE\n");
+            len += scnprintf(buf + len, PROC_BUF_LEN - len, "IDLE\n");
             break;
         case LOADING:
-            len += sprintf(buf + len, "LOADING\n");
+            len += scnprintf(buf + len, PROC_BUF_LEN - len, "LOADING\n");
             break;
         case UP:
-            len += sprintf(buf + len, "UP\n");
+            len += scnprintf(buf + len, PROC_BUF_LEN - len, "UP\n");
             break;
         case DOWN:
-            len += sprintf(buf + len, "DOWN\n");
+            len += scnprintf(buf + len, PROC_BUF_LEN - len, "DOWN\n");
                  break;
     }
-    len += sprintf(buf + len, "Current floor: %d\n", elevator.current_floor); 
-    len += sprintf(buf + len, "Current load: %d lbs\n", elevator.total_weight);
-    len += sprintf(buf + len, "Elevator status: ");
+    len += scnprintf(buf + len, PROC_BUF_LEN - len, "Current floor: %d\n", elevator.current_floor);
+    len += scnprintf(buf + len, PROC_BUF_LEN - len, "Current load: %d lbs\n", elevator.total_weight);
+    len += scnprintf(buf + len, PROC_BUF_LEN - len, "Elevator status: ");
     list_for_each_entry(passenger, &elevator.passengers, list) {
-        len += sprintf(buf + len, "%c%d ", passenger->type, passenger->destination_floor);
+        len += scnprintf(buf + len, PROC_BUF_LEN - len, "%c%d ", passenger->type, passenger->destination_floor);
     }
-    len += sprintf(buf + len, "\n");
+    len += scnprintf(buf + len, PROC_BUF_LEN - len, "\n");
 
     // Print floors information
     for (int i = 0; i < MAX_FLOORS; i++) {
-        mutex_lock(&floors[i].floor_mutex);
-        len += sprintf(buf + len, "[%c] Floor %d: %d ", (elevator.current_floor 
+        profiled_lock(&floors[i].floor_mutex, &floors[i].lock_stats);
+        len += scnprintf(buf + len, PROC_BUF_LEN - len, "[%c] Floor %d: %d ", (elevator.current_floor
 			== floors[i].floor_number) ? '*' : ' '
 			, floors[i].floor_number, floors[i].num_passengers_waiting);
-        list_for_each_entry(passenger, &floors[i].passengers, list) {
-            len += sprintf(buf + len, "%c%d ", passenger->type, passenger->destination_floor);
+        list_for_each_entry(passenger, &floors[i].up_passengers, list) {
+            len += scnprintf(buf + len, PROC_BUF_LEN - len, "%c%d ", passenger->type, passenger->destination_floor);
         }
-        len += sprintf(buf + len, "\n");
-        mutex_unlock(&floors[i].floor_mutex);
+        list_for_each_entry(passenger, &floors[i].down_passengers, list) {
+            len += scnprintf(buf + len, PROC_BUF_LEN - len, "%c%d ", passenger->type, passenger->destination_floor);
+        }
+        len += scnprintf(buf + len, PROC_BUF_LEN - len, "\n");
+        profiled_unlock(&floors[i].floor_mutex, &floors[i].lock_stats);
     }
 
-    mutex_unlock(&elevator_mutex);
+    profiled_unlock(&elevator_mutex, &elevator_lock_stats);
 
     //get the total number of passengers waiting from the previously defined function
     int waiting = get_num_waiting();
 
-    len += sprintf(buf + len, "\n");
-    len += sprintf(buf + len, "Number of passengers: %d\n", elevator.passenger_count);
-    len += sprintf(buf + len, "Number of passengers waiting: %d\n", waiting);
-    len += sprintf(buf + len, "Number of passengers serviced: %d\n", elevator.total_serviced);
+    len += scnprintf(buf + len, PROC_BUF_LEN - len, "\n");
+    len += scnprintf(buf + len, PROC_BUF_LEN - len, "Number of passengers: %d\n", elevator.passenger_count);
+    len += scnprintf(buf + len, PROC_BUF_LEN - len, "Number of passengers waiting: %d\n", waiting);
+    len += scnprintf(buf + len, PROC_BUF_LEN - len, "Number of passengers serviced: %d\n", elevator.total_serviced);
+    phase_end(PHASE_RENDER, start);
 
     // Copy buffer to user space
     len = simple_read_from_buffer(ubuf, count, ppos, buf, len);
@@ -432,6 +642,166 @@ static const struct proc_ops elevator_fops = {
     .proc_read = elevator_read,
 };
 
+//print one mutex's profiling counters
+static ssize_t print_lock_stats(char *buf, ssize_t len, const char *name, int index,
+                                const LockStats *lock_stats) {
+    char label[32];
+
+    if (index > 0) {
+        snprintf(label, sizeof(label), "%s[%d]", name, index);
+    } else {
+        snprintf(label, sizeof(label), "%s", name);
+    }
+
+    return scnprintf(buf + len, STATS_BUF_LEN - len, "%-20s %12llu %12llu %16llu %16llu\n",
+                     label, lock_stats->acquisitions, lock_stats->contended,
+                     lock_stats->wait_ns, lock_stats->hold_ns);
+}
+
+//prints the lock and phase profiling counters to the stats proc file
+static ssize_t stats_read(struct file *file, char __user *ubuf, size_t count, loff_t *ppos) {
+    char *buf;
+    ssize_t len = 0;
+
+    buf = kmalloc(STATS_BUF_LEN, GFP_KERNEL);
+    if (!buf) {
+        return -ENOMEM;
+    }
+
+    // Counters are read without taking the locks they describe so that
+    // reading them does not show up as contention
+    len += scnprintf(buf + len, STATS_BUF_LEN - len, "Profiling: %s\n\n",
+                     static_key_enabled(&elevator_stats_key) ? "on" : "off");
+    len += scnprintf(buf + len, STATS_BUF_LEN - len, "%-20s %12s %12s %16s %16s\n",
+                     "lock", "acquired", "contended", "wait_ns", "hold_ns");
+    len += print_lock_stats(buf, len, "elevator_mutex", 0, &elevator_lock_stats);
+    for (int i = 0; i < MAX_FLOORS; i++) {
+        len += print_lock_stats(buf, len, "floor_mutex", floors[i].floor_number,
+                                &floors[i].lock_stats);
+    }
+
+    len += scnprintf(buf + len, STATS_BUF_LEN - len, "\n%-20s %12s %16s %12s %12s\n",
+                     "phase", "calls", "total_ns", "avg_ns", "max_ns");
+    for (int i = 0; i < NUM_PHASES; i++) {
+        u64 calls = atomic64_read(&phase_stats[i].calls);
+        u64 total = atomic64_read(&phase_stats[i].total_ns);
+
+        len += scnprintf(buf + len, STATS_BUF_LEN - len, "%-20s %12llu %16llu %12llu %12llu\n",
+                         phase_names[i], calls, total, calls ? div64_u64(total, calls) : 0,
+                         (u64)atomic64_read(&phase_stats[i].max_ns));
+    }
+
+    len = simple_read_from_buffer(ubuf, count, ppos, buf, len);
+    kfree(buf);
+    return len;
+}
+
+//zero every profiling counter
+static void reset_stats(void) {
+    // Each lock's counters are cleared while holding that lock, one lock at
+    // a time; plain mutex_lock() keeps the reset itself out of the counters
+    mutex_lock(&elevator_mutex);
+    memset(&elevator_lock_stats, 0, sizeof(elevator_lock_stats));
+    mutex_unlock(&elevator_mutex);
+
+    for (int i = 0; i < MAX_FLOORS; i++) {
+        mutex_lock(&floors[i].floor_mutex);
+        memset(&floors[i].lock_stats, 0, sizeof(floors[i].lock_stats));
+        mutex_unlock(&floors[i].floor_mutex);
+    }
+
+    for (int i = 0; i < NUM_PHASES; i++) {
+        atomic64_set(&phase_stats[i].calls, 0);
+        atomic64_set(&phase_stats[i].total_ns, 0);
+        atomic64_set(&phase_stats[i].max_ns, 0);
+    }
+}
+
+//"1" turns profiling on, "0" turns it off and "reset" zeroes the counters
+static ssize_t stats_write(struct file *file, const char __user *ubuf, size_t count, loff_t *ppos) {
+    char cmd[8];
+    size_t len = min(count, sizeof(cmd) - 1);
+
+    if (copy_from_user(cmd, ubuf, len)) {
+        return -EFAULT;
+    }
+    cmd[len] = '\0';
+
+    if (sysfs_streq(cmd, "1")) {
+        static_branch_enable(&elevator_stats_key);
+    } else if (sysfs_streq(cmd, "0")) {
+        static_branch_disable(&elevator_stats_key);
+    } else if (sysfs_streq(cmd, "reset")) {
+        reset_stats();
+    } else {
+        return -EINVAL;
+    }
+
+    return count;
+}
+
+//fill a binary snapshot of the elevator for /proc/elevator_bin
+static void fill_snapshot(struct elevator_snapshot *snap) {
+    u32 total_waiting = 0;
+
+    snap->magic = ELEVATOR_SNAPSHOT_MAGIC;
+    snap->version = ELEVATOR_SNAPSHOT_VERSION;
+    snap->header_size = sizeof(*snap);
+    snap->num_floors = MAX_FLOORS;
+    snap->reserved = 0;
+
+    // Same lock order as elevator_read(): elevator, then each floor
+    profiled_lock(&elevator_mutex, &elevator_lock_stats);
+    snap->timestamp_ns = ktime_get_ns();
+    snap->state = elevator.state;
+    snap->direction = elevator.direction;
+    snap->current_floor = elevator.current_floor;
+    snap->passenger_count = elevator.passenger_count;
+    snap->total_weight = elevator.total_weight;
+    snap->total_serviced = elevator.total_serviced;
+
+    for (int i = 0; i < MAX_FLOORS; i++) {
+        profiled_lock(&floors[i].floor_mutex, &floors[i].lock_stats);
+        snap->floors[i].waiting_up = floors[i].num_waiting_up;
+        snap->floors[i].waiting_down = floors[i].num_waiting_down;
+        total_waiting += floors[i].num_passengers_waiting;
+        profiled_unlock(&floors[i].floor_mutex, &floors[i].lock_stats);
+    }
+    profiled_unlock(&elevator_mutex, &elevator_lock_stats);
+
+    snap->total_waiting = total_waiting;
+}
+
+//binary counterpart of elevator_read() for high-frequency pollers
+static ssize_t elevator_bin_read(struct file *file, char __user *ubuf, size_t count, loff_t *ppos) {
+    struct elevator_snapshot *snap;
+    size_t size = struct_size(snap, floors, MAX_FLOORS);
+    ssize_t len;
+    u64 start;
+
+    snap = kmalloc(size, GFP_KERNEL);
+    if (!snap) {
+        return -ENOMEM;
+    }
+
+    start = phase_begin();
+    fill_snapshot(snap);
+    phase_end(PHASE_RENDER_BIN, start);
+
+    len = simple_read_from_buffer(ubuf, count, ppos, snap, size);
+    kfree(snap);
+    return len;
+}
+
+static const struct proc_ops elevator_bin_fops = {
+    .proc_read = elevator_bin_read,
+};
+
+static const struct proc_ops stats_fops = {
+    .proc_read = stats_read,
+    .proc_write = stats_write,
+};
+
 static int __init elevator_init(void) {
 
     //link the stubs in syscalls.c to elevator.c
@@ -444,12 +814,31 @@ static int __init elevator_init(void) {
         return -ENOMEM;
     }
 
+    stats_entry = proc_create(STATS_ENTRY_NAME, PERMS, PARENT, &stats_fops);
+    if (!stats_entry) {
+        proc_remove(elevator_entry);
+        return -ENOMEM;
+    }
+    if (stats) {
+        static_branch_enable(&elevator_stats_key);
+    }
+
+    bin_entry = proc_create(BIN_ENTRY_NAME, PERMS, PARENT, &elevator_bin_fops);
+    if (!bin_entry) {
+        proc_remove(stats_entry);
+        proc_remove(elevator_entry);
+        return -ENOMEM;
+    }
+
     // Initialize floors
     for (int i = 0; i < MAX_FLOORS; ++i) {
         floors[i].floor_number = i + 1;
         floors[i].num_passengers_waiting = 0;
+        floors[i].num_waiting_up = 0;
+        floors[i].num_waiting_down = 0;
         mutex_init(&floors[i].floor_mutex);
-        INIT_LIST_HEAD(&floors[i].passengers);
+        INIT_LIST_HEAD(&floors[i].up_passengers);
+        INIT_LIST_HEAD(&floors[i].down_passengers);
     }
 
     // Create kthread for elevator movement
@@ -484,7 +873,11 @@ static void __exit elevator_exit(void) {
     }
 
     for (int i = 0; i < MAX_FLOORS; ++i) {
-        list_for_each_entry_safe(passenger, temp, &floors[i].passengers, list) {
+        list_for_each_entry_safe(passenger, temp, &floors[i].up_passengers, list) {
+            list_del(&passenger->list);
+            kfree(passenger);
+        }
+        list_for_each_entry_safe(passenger, temp, &floors[i].down_passengers, list) {
             list_del(&passenger->list);
             kfree(passenger);
         }
@@ -492,9 +885,15 @@ static void __exit elevator_exit(void) {
         mutex_destroy(&floors[i].floor_mutex);
     }
 
+    proc_remove(bin_entry);
+    proc_remove(stats_entry);
     proc_remove(elevator_entry);
     mutex_destroy(&elevator_mutex);
 }
 
 module_init(elevator_init);
 module_exit(elevator_exit);
+
+#if IS_ENABLED(CONFIG_ELEVATOR_KUNIT_TEST)
+#include "elevator_test.c"
+#endif
@@ -0,0 +1,52 @@
+#ifndef ELEVATOR_SNAPSHOT_H
+#define ELEVATOR_SNAPSHOT_H
+
+#include <linux/types.h>
+
+// Binary layout of /proc/elevator_bin, shared by the module and pollers.
+//
+// Each read at offset 0 returns one consistent snapshot: this fixed header
+// followed by num_floors per-floor entries (floor 1 first). Read the whole
+// snapshot in a single read/pread at offset 0; a read that starts past
+// offset 0 is served from a newer snapshot. Check magic and version before
+// use, and use header_size to find the floors so later versions can grow
+// the header.
+
+#define ELEVATOR_SNAPSHOT_MAGIC 0x53564c45 // "ELVS" little endian
+#define ELEVATOR_SNAPSHOT_VERSION 1
+
+// Values of state, the same as ElevatorState in elevator.c
+#define ELEVATOR_SNAPSHOT_OFFLINE 0
+#define ELEVATOR_SNAPSHOT_IDLE 1
+#define ELEVATOR_SNAPSHOT_LOADING 2
+#define ELEVATOR_SNAPSHOT_UP 3
+#define ELEVATOR_SNAPSHOT_DOWN 4
+
+// The waiting counts are unbounded in the module, so these are as wide as
+// total_waiting
+struct elevator_snapshot_floor {
+    __u32 waiting_up;
+    __u32 waiting_down;
+};
+
+struct elevator_snapshot {
+    __u32 magic;          // ELEVATOR_SNAPSHOT_MAGIC
+    __u16 version;        // ELEVATOR_SNAPSHOT_VERSION
+    __u16 header_size;    // Bytes before floors[]
+    __u64 timestamp_ns;   // CLOCK_MONOTONIC time the snapshot was taken
+    __u8 state;           // ELEVATOR_SNAPSHOT_*
+    __u8 direction;       // ELEVATOR_SNAPSHOT_UP or ELEVATOR_SNAPSHOT_DOWN
+    __u16 num_floors;
+    __u16 current_floor;
+    __u16 passenger_count;
+    __u32 total_weight;
+    __u32 total_serviced;
+    __u32 total_waiting;
+    __u32 reserved;
+    struct elevator_snapshot_floor floors[];
+};
+
+_Static_assert(sizeof(struct elevator_snapshot) == 40, "elevator_snapshot layout changed");
+_Static_assert(sizeof(struct elevator_snapshot_floor) == 8, "elevator_snapshot_floor layout changed");
+
+#endif
@@ -0,0 +1,544 @@
+// KUnit tests and microbenchmarks for the elevator state machine.
+//
+// This file is #included at the bottom of elevator.c so it can reach the
+// static state machine functions. It is only compiled when
+// CONFIG_ELEVATOR_KUNIT_TEST is set: make KUNIT=1 builds it into the module
+// for a kernel with CONFIG_KUNIT, kunit.py runs it under UML with Part3 in a
+// kernel tree (Kconfig, .kunitconfig and the README), and make -C usersim
+// kunit runs it in userspace against the stub kernel API.
+//
+// Cases for the known bugs in the README SideNotes assert the correct
+// behavior and are skipped with kunit_skip() until the bugs are fixed.
+//
+// The suite stops the elevator kthread before running and restarts it when
+// done, so every test drives unload/load/decide by hand and is deterministic.
+
+#include <kunit/test.h>
+
+#define TYPE_PART_TIME 0
+#define TYPE_LAWYER 1
+#define TYPE_BOSS 2
+#define TYPE_VISITOR 3
+
+// The cases are written for the assignment's five floors (floors[2],
+// requests to floor 5); FLOORS=n may only make the building taller
+static_assert(MAX_FLOORS >= 5, "elevator_test.c needs MAX_FLOORS >= 5");
+
+#define BENCH_PASSENGERS 10000
+#define BENCH_ITERATIONS 1000
+
+// Baseline from make -C usersim kunit (userspace, gcc -O2, 2.1GHz Xeon),
+// in ns/call; in-kernel numbers have not been recorded yet.
+//   FLOORS  should_stop  decide_next_action  load_passengers
+//        5        16055               81949               41
+//       20        14863               59516               41
+//      100        15350               64431               47
+
+//free every passenger in a list
+static void free_passenger_list(struct list_head *list) {
+    Passenger *passenger, *temp;
+
+    list_for_each_entry_safe(passenger, temp, list, list) {
+        list_del(&passenger->list);
+        kfree(passenger);
+    }
+}
+
+//empty the car and every floor and park the elevator on floor 1
+static void elevator_test_reset(void) {
+    free_passenger_list(&elevator.passengers);
+    for (int i = 0; i < MAX_FLOORS; i++) {
+        free_passenger_list(&floors[i].up_passengers);
+        free_passenger_list(&floors[i].down_passengers);
+        floors[i].num_passengers_waiting = 0;
+        floors[i].num_waiting_up = 0;
+        floors[i].num_waiting_down = 0;
+    }
+
+    elevator.state = LOADING;
+    elevator.direction = UP;
+    elevator.current_floor = 1;
+    elevator.total_weight = 0;
+    elevator.passenger_count = 0;
+    elevator.total_serviced = 0;
+}
+
+//put a rider straight into the car, bypassing the capacity checks
+static void add_car_passenger(struct kunit *test, int dest, int weight) {
+    Passenger *passenger = kmalloc(sizeof(Passenger), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, passenger);
+    passenger->type = 'P';
+    passenger->destination_floor = dest;
+    passenger->weight = weight;
+    passenger->decimal = false;
+    list_add_tail(&passenger->list, &elevator.passengers);
+    elevator.total_weight += weight;
+    elevator.passenger_count++;
+}
+
+//queue a rider through the syscall path
+static void add_waiting(struct kunit *test, int start, int dest, int type) {
+    KUNIT_ASSERT_EQ(test, issue_request(start, dest, type), 0);
+}
+
+static int elevator_test_init(struct kunit *test) {
+    elevator_test_reset();
+    return 0;
+}
+
+static void elevator_test_exit(struct kunit *test) {
+    elevator_test_reset();
+}
+
+static int elevator_test_suite_init(struct kunit_suite *suite) {
+    // The tests own the state machine; nothing else may move the car
+    if (elevator_thread) {
+        kthread_stop(elevator_thread);
+        elevator_thread = NULL;
+    }
+    return 0;
+}
+
+static void elevator_test_suite_exit(struct kunit_suite *suite) {
+    elevator_test_reset();
+    elevator.state = OFFLINE;
+
+    elevator_thread = kthread_run(elevator_movement, NULL, "elevator_thread");
+    if (IS_ERR(elevator_thread)) {
+        pr_err("Failed to restart elevator thread\n");
+        elevator_thread = NULL;
+    }
+}
+
+static void issue_request_rejects_bad_input(struct kunit *test) {
+    KUNIT_EXPECT_EQ(test, issue_request(0, 2, TYPE_BOSS), -EINVAL);
+    KUNIT_EXPECT_EQ(test, issue_request(1, MAX_FLOORS + 1, TYPE_BOSS), -EINVAL);
+    KUNIT_EXPECT_EQ(test, issue_request(1, 2, MAX_PASSENGER_TYPES), -EINVAL);
+    KUNIT_EXPECT_EQ(test, get_num_waiting(), 0);
+}
+
+static void issue_request_queues_by_direction(struct kunit *test) {
+    add_waiting(test, 2, 4, TYPE_PART_TIME);
+    add_waiting(test, 2, 1, TYPE_BOSS);
+    add_waiting(test, 2, 3, TYPE_VISITOR);
+
+    KUNIT_EXPECT_EQ(test, floors[1].num_waiting_up, 2);
+    KUNIT_EXPECT_EQ(test, floors[1].num_waiting_down, 1);
+    KUNIT_EXPECT_EQ(test, floors[1].num_passengers_waiting, 3);
+}
+
+static void issue_request_wakes_idle_elevator(struct kunit *test) {
+    elevator.state = IDLE;
+    elevator.current_floor = 3;
+    add_waiting(test, 1, 5, TYPE_PART_TIME);
+    KUNIT_EXPECT_EQ(test, elevator.state, DOWN);
+    KUNIT_EXPECT_EQ(test, elevator.direction, DOWN);
+
+    elevator.state = IDLE;
+    add_waiting(test, 3, 1, TYPE_PART_TIME);
+    KUNIT_EXPECT_EQ(test, elevator.state, LOADING);
+    KUNIT_EXPECT_EQ(test, elevator.direction, DOWN);
+}
+
+static void load_respects_passenger_limit(struct kunit *test) {
+    for (int i = 0; i < MAX_PASSENGERS + 2; i++) {
+        add_waiting(test, 1, 3, TYPE_PART_TIME);
+    }
+
+    load_passengers();
+
+    KUNIT_EXPECT_EQ(test, elevator.passenger_count, MAX_PASSENGERS);
+    KUNIT_EXPECT_EQ(test, floors[0].num_waiting_up, 2);
+    KUNIT_EXPECT_EQ(test, floors[0].num_passengers_waiting, 2);
+}
+
+static void load_respects_weight_limit(struct kunit *test) {
+    for (int i = 0; i < 5; i++) {
+        add_waiting(test, 1, 3, TYPE_BOSS);
+    }
+
+    load_passengers();
+
+    // Bosses weigh 2, so only three fit under MAX_WEIGHT
+    KUNIT_EXPECT_EQ(test, elevator.passenger_count, MAX_WEIGHT / 2);
+    KUNIT_EXPECT_EQ(test, elevator.total_weight, (MAX_WEIGHT / 2) * 2);
+    KUNIT_EXPECT_LE(test, elevator.total_weight, MAX_WEIGHT);
+    KUNIT_EXPECT_EQ(test, floors[0].num_waiting_up, 5 - MAX_WEIGHT / 2);
+}
+
+static void load_boards_in_arrival_order(struct kunit *test) {
+    for (int i = 0; i < 4; i++) {
+        add_waiting(test, 1, 3, TYPE_BOSS);
+    }
+    add_waiting(test, 1, 3, TYPE_PART_TIME);
+
+    load_passengers();
+
+    // Boarding stops at the first rider who does not fit, so the part-time
+    // worker queued behind the fourth boss waits even though they would fit
+    KUNIT_EXPECT_EQ(test, elevator.passenger_count, 3);
+    KUNIT_EXPECT_EQ(test, floors[0].num_waiting_up, 2);
+}
+
+static void load_only_current_direction(struct kunit *test) {
+    elevator.current_floor = 2;
+    elevator.direction = UP;
+    add_waiting(test, 2, 4, TYPE_PART_TIME);
+    add_waiting(test, 2, 1, TYPE_PART_TIME);
+
+    load_passengers();
+
+    KUNIT_EXPECT_EQ(test, elevator.passenger_count, 1);
+    KUNIT_EXPECT_EQ(test, elevator.direction, UP);
+    KUNIT_EXPECT_EQ(test, floors[1].num_waiting_up, 0);
+    KUNIT_EXPECT_EQ(test, floors[1].num_waiting_down, 1);
+}
+
+static void load_reverses_at_end_of_run(struct kunit *test) {
+    elevator.current_floor = 3;
+    elevator.direction = UP;
+    add_waiting(test, 3, 1, TYPE_LAWYER);
+
+    load_passengers();
+
+    KUNIT_EXPECT_EQ(test, elevator.direction, DOWN);
+    KUNIT_EXPECT_EQ(test, elevator.passenger_count, 1);
+    KUNIT_EXPECT_EQ(test, floors[2].num_passengers_waiting, 0);
+}
+
+static void unload_only_riders_for_this_floor(struct kunit *test) {
+    elevator.current_floor = 2;
+    add_car_passenger(test, 2, 1);
+    add_car_passenger(test, 3, 2);
+    add_car_passenger(test, 2, 2);
+
+    unload_passengers();
+
+    KUNIT_EXPECT_EQ(test, elevator.passenger_count, 1);
+    KUNIT_EXPECT_EQ(test, elevator.total_weight, 2);
+    KUNIT_EXPECT_EQ(test, elevator.total_serviced, 2);
+    KUNIT_EXPECT_EQ(test, list_first_entry(&elevator.passengers, Passenger, list)->destination_floor, 3);
+}
+
+static void load_then_unload_restores_weight(struct kunit *test) {
+    add_waiting(test, 1, 2, TYPE_BOSS);
+    add_waiting(test, 1, 2, TYPE_PART_TIME);
+    add_waiting(test, 1, 2, TYPE_BOSS);
+
+    load_passengers();
+    KUNIT_EXPECT_EQ(test, elevator.total_weight, 5);
+
+    elevator.current_floor = 2;
+    unload_passengers();
+    KUNIT_EXPECT_EQ(test, elevator.total_weight, 0);
+    KUNIT_EXPECT_EQ(test, elevator.passenger_count, 0);
+    KUNIT_EXPECT_EQ(test, elevator.total_serviced, 3);
+}
+
+static void decide_keeps_direction_with_demand_ahead(struct kunit *test) {
+    elevator.current_floor = 3;
+    elevator.direction = UP;
+    add_car_passenger(test, 5, 1);
+    add_waiting(test, 1, 2, TYPE_PART_TIME);
+
+    decide_next_action();
+
+    KUNIT_EXPECT_EQ(test, elevator.state, UP);
+    KUNIT_EXPECT_EQ(test, elevator.direction, UP);
+}
+
+static void decide_reverses_when_run_is_done(struct kunit *test) {
+    elevator.current_floor = 3;
+    elevator.direction = UP;
+    add_waiting(test, 1, 2, TYPE_PART_TIME);
+
+    decide_next_action();
+
+    KUNIT_EXPECT_EQ(test, elevator.state, DOWN);
+    KUNIT_EXPECT_EQ(test, elevator.direction, DOWN);
+}
+
+static void decide_idles_without_work(struct kunit *test) {
+    elevator.current_floor = 3;
+
+    decide_next_action();
+
+    KUNIT_EXPECT_EQ(test, elevator.state, IDLE);
+}
+
+static void should_stop_for_drop_off(struct kunit *test) {
+    elevator.direction = UP;
+    add_car_passenger(test, 4, 1);
+
+    KUNIT_EXPECT_TRUE(test, should_stop(4));
+    KUNIT_EXPECT_FALSE(test, should_stop(3));
+}
+
+static void should_stop_for_same_direction_rider(struct kunit *test) {
+    elevator.direction = UP;
+    add_waiting(test, 3, 5, TYPE_VISITOR);
+
+    KUNIT_EXPECT_TRUE(test, should_stop(3));
+}
+
+static void should_stop_skips_opposite_rider_mid_run(struct kunit *test) {
+    elevator.direction = UP;
+    add_waiting(test, 3, 1, TYPE_VISITOR);
+    add_car_passenger(test, 5, 1);
+
+    // Still work above, so the down rider is picked up on the way back
+    KUNIT_EXPECT_FALSE(test, should_stop(3));
+
+    free_passenger_list(&elevator.passengers);
+    elevator.passenger_count = 0;
+    elevator.total_weight = 0;
+
+    // Nothing left above, so this is where the car turns around
+    KUNIT_EXPECT_TRUE(test, should_stop(3));
+}
+
+static void start_and_stop_transitions(struct kunit *test) {
+    elevator.state = OFFLINE;
+    KUNIT_EXPECT_EQ(test, stop_elevator(), 0);
+    KUNIT_EXPECT_EQ(test, start_elevator(), 0);
+    KUNIT_EXPECT_EQ(test, elevator.state, IDLE);
+    KUNIT_EXPECT_EQ(test, start_elevator(), -EINVAL);
+    KUNIT_EXPECT_EQ(test, elevator.state, IDLE);
+}
+
+static void stop_with_empty_car_keeps_waiting(struct kunit *test) {
+    add_waiting(test, 2, 1, TYPE_BOSS);
+    elevator.state = IDLE;
+
+    KUNIT_EXPECT_EQ(test, stop_elevator(), 0);
+
+    KUNIT_EXPECT_EQ(test, elevator.state, OFFLINE);
+    KUNIT_EXPECT_EQ(test, get_num_waiting(), 1);
+}
+
+static void stop_lets_riders_finish_trips(struct kunit *test) {
+    kunit_skip(test, "known bug (README SideNotes): stop_elevator() deletes riders "
+               "mid-ride instead of delivering them before going offline");
+
+    elevator.state = UP;
+    elevator.current_floor = 3;
+    add_car_passenger(test, 4, 2);
+    add_car_passenger(test, 5, 1);
+
+    KUNIT_EXPECT_EQ(test, stop_elevator(), 0);
+
+    // Riders already aboard stay on until their floors
+    KUNIT_EXPECT_NE(test, elevator.state, OFFLINE);
+    KUNIT_EXPECT_EQ(test, elevator.passenger_count, 2);
+
+    elevator.current_floor = 4;
+    unload_passengers();
+    elevator.current_floor = 5;
+    unload_passengers();
+    KUNIT_EXPECT_EQ(test, elevator.total_serviced, 2);
+
+    // With the car empty the elevator finishes stopping
+    decide_next_action();
+    KUNIT_EXPECT_EQ(test, elevator.state, OFFLINE);
+}
+
+static void lawyer_weighs_one_and_a_half(struct kunit *test) {
+    kunit_skip(test, "known bug (README SideNotes): issue_request() truncates the "
+               "lawyer's 1.5 weight to 1");
+
+    for (int i = 0; i < MAX_PASSENGERS; i++) {
+        add_waiting(test, 1, 3, TYPE_LAWYER);
+    }
+
+    load_passengers();
+
+    // Four lawyers weigh 6; a fifth would make 7.5, over MAX_WEIGHT
+    KUNIT_EXPECT_EQ(test, elevator.passenger_count, 4);
+    KUNIT_EXPECT_EQ(test, floors[0].num_waiting_up, 1);
+}
+
+static void two_visitors_weigh_one_part_time_worker(struct kunit *test) {
+    int visitors_weight;
+
+    kunit_skip(test, "known bug (README SideNotes): issue_request() truncates the "
+               "visitor's 0.5 weight to 0");
+
+    add_waiting(test, 1, 3, TYPE_VISITOR);
+    add_waiting(test, 1, 3, TYPE_VISITOR);
+    add_waiting(test, 2, 3, TYPE_PART_TIME);
+
+    load_passengers();
+    visitors_weight = elevator.total_weight;
+    elevator.current_floor = 3;
+    unload_passengers();
+    elevator.current_floor = 2;
+    load_passengers();
+
+    KUNIT_EXPECT_GT(test, visitors_weight, 0);
+    KUNIT_EXPECT_EQ(test, visitors_weight, elevator.total_weight);
+}
+
+static void snapshot_reports_counts(struct kunit *test) {
+    struct elevator_snapshot *snap;
+
+    snap = kunit_kzalloc(test, struct_size(snap, floors, MAX_FLOORS), GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, snap);
+
+    elevator.current_floor = 2;
+    elevator.direction = DOWN;
+    add_car_passenger(test, 1, 2);
+    add_waiting(test, 3, 5, TYPE_BOSS);
+    add_waiting(test, 3, 1, TYPE_VISITOR);
+    add_waiting(test, 3, 2, TYPE_VISITOR);
+
+    fill_snapshot(snap);
+
+    KUNIT_EXPECT_EQ(test, snap->magic, ELEVATOR_SNAPSHOT_MAGIC);
+    KUNIT_EXPECT_EQ(test, snap->version, ELEVATOR_SNAPSHOT_VERSION);
+    KUNIT_EXPECT_EQ(test, snap->header_size, sizeof(*snap));
+    KUNIT_EXPECT_EQ(test, snap->num_floors, MAX_FLOORS);
+    KUNIT_EXPECT_EQ(test, snap->state, ELEVATOR_SNAPSHOT_LOADING);
+    KUNIT_EXPECT_EQ(test, snap->direction, ELEVATOR_SNAPSHOT_DOWN);
+    KUNIT_EXPECT_EQ(test, snap->current_floor, 2);
+    KUNIT_EXPECT_EQ(test, snap->passenger_count, 1);
+    KUNIT_EXPECT_EQ(test, snap->total_weight, 2);
+    KUNIT_EXPECT_EQ(test, snap->total_waiting, 3);
+    KUNIT_EXPECT_EQ(test, snap->floors[2].waiting_up, 1);
+    KUNIT_EXPECT_EQ(test, snap->floors[2].waiting_down, 2);
+    KUNIT_EXPECT_EQ(test, snap->floors[0].waiting_up + snap->floors[0].waiting_down, 0);
+}
+
+static void snapshot_floor_counts_do_not_wrap(struct kunit *test) {
+    struct elevator_snapshot *snap;
+
+    snap = kunit_kzalloc(test, struct_size(snap, floors, MAX_FLOORS), GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, snap);
+
+    // Only the counts matter here; the exit hook zeroes them again
+    floors[1].num_waiting_up = 70000;
+    floors[1].num_waiting_down = 65536;
+    floors[1].num_passengers_waiting = 135536;
+
+    fill_snapshot(snap);
+
+    KUNIT_EXPECT_EQ(test, snap->floors[1].waiting_up, 70000);
+    KUNIT_EXPECT_EQ(test, snap->floors[1].waiting_down, 65536);
+    KUNIT_EXPECT_EQ(test, snap->total_waiting, 135536);
+}
+
+//fill the car with riders none of whom get off on the checked floors
+static void fill_car_for_bench(struct kunit *test, int dest) {
+    for (int i = 0; i < BENCH_PASSENGERS; i++) {
+        add_car_passenger(test, dest, 0);
+    }
+}
+
+static void bench_should_stop(struct kunit *test) {
+    u64 start, elapsed;
+    int stops = 0;
+
+    // Worst case: every rider is scanned and no floor has waiting riders
+    elevator.direction = UP;
+    fill_car_for_bench(test, MAX_FLOORS);
+
+    start = ktime_get_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        stops += should_stop(1 + i % (MAX_FLOORS - 1));
+    }
+    elapsed = ktime_get_ns() - start;
+
+    KUNIT_EXPECT_EQ(test, stops, 0);
+    kunit_info(test, "should_stop: %d floors, %d riders: %llu ns/call\n",
+               MAX_FLOORS, BENCH_PASSENGERS, div64_u64(elapsed, BENCH_ITERATIONS));
+}
+
+static void bench_decide_next_action(struct kunit *test) {
+    u64 start, elapsed;
+
+    // Every rider gets off on the car's own floor and the only waiting
+    // rider is on the bottom floor, so both directions are scanned end to end
+    elevator.current_floor = MAX_FLOORS;
+    elevator.state = LOADING;
+    fill_car_for_bench(test, MAX_FLOORS);
+    add_waiting(test, 1, 2, TYPE_PART_TIME);
+
+    start = ktime_get_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        elevator.direction = UP;
+        decide_next_action();
+    }
+    elapsed = ktime_get_ns() - start;
+
+    KUNIT_EXPECT_EQ(test, elevator.state, DOWN);
+    kunit_info(test, "decide_next_action: %d floors, %d riders: %llu ns/call\n",
+               MAX_FLOORS, BENCH_PASSENGERS, div64_u64(elapsed, BENCH_ITERATIONS));
+}
+
+static void bench_load_passengers(struct kunit *test) {
+    u64 start, elapsed = 0;
+    Floor *floor = &floors[0];
+
+    for (int i = 0; i < BENCH_PASSENGERS; i++) {
+        add_waiting(test, 1, 2, TYPE_PART_TIME);
+    }
+
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        start = ktime_get_ns();
+        load_passengers();
+        elapsed += ktime_get_ns() - start;
+
+        // Put the riders back at the end of the queue (untimed)
+        floor->num_waiting_up += elevator.passenger_count;
+        floor->num_passengers_waiting += elevator.passenger_count;
+        list_splice_tail_init(&elevator.passengers, &floor->up_passengers);
+        elevator.passenger_count = 0;
+        elevator.total_weight = 0;
+        elevator.direction = UP;
+    }
+
+    KUNIT_EXPECT_EQ(test, floor->num_waiting_up, BENCH_PASSENGERS);
+    kunit_info(test, "load_passengers: %d waiting: %llu ns/call\n",
+               BENCH_PASSENGERS, div64_u64(elapsed, BENCH_ITERATIONS));
+}
+
+static struct kunit_case elevator_test_cases[] = {
+    KUNIT_CASE(issue_request_rejects_bad_input),
+    KUNIT_CASE(issue_request_queues_by_direction),
+    KUNIT_CASE(issue_request_wakes_idle_elevator),
+    KUNIT_CASE(load_respects_passenger_limit),
+    KUNIT_CASE(load_respects_weight_limit),
+    KUNIT_CASE(load_boards_in_arrival_order),
+    KUNIT_CASE(load_only_current_direction),
+    KUNIT_CASE(load_reverses_at_end_of_run),
+    KUNIT_CASE(unload_only_riders_for_this_floor),
+    KUNIT_CASE(load_then_unload_restores_weight),
+    KUNIT_CASE(decide_keeps_direction_with_demand_ahead),
+    KUNIT_CASE(decide_reverses_when_run_is_done),
+    KUNIT_CASE(decide_idles_without_work),
+    KUNIT_CASE(should_stop_for_drop_off),
+    KUNIT_CASE(should_stop_for_same_direction_rider),
+    KUNIT_CASE(should_stop_skips_opposite_rider_mid_run),
+    KUNIT_CASE(start_and_stop_transitions),
+    KUNIT_CASE(stop_with_empty_car_keeps_waiting),
+    KUNIT_CASE(stop_lets_riders_finish_trips),
+    KUNIT_CASE(lawyer_weighs_one_and_a_half),
+    KUNIT_CASE(two_visitors_weigh_one_part_time_worker),
+    KUNIT_CASE(snapshot_reports_counts),
+    KUNIT_CASE(snapshot_floor_counts_do_not_wrap),
+    KUNIT_CASE_SLOW(bench_should_stop),
+    KUNIT_CASE_SLOW(bench_decide_next_action),
+    KUNIT_CASE_SLOW(bench_load_passengers),
+    {}
+};
+
+static struct kunit_suite elevator_test_suite = {
+    .name = "elevator",
+    .init = elevator_test_init,
+    .exit = elevator_test_exit,
+    .suite_init = elevator_test_suite_init,
+    .suite_exit = elevator_test_suite_exit,
+    .test_cases = elevator_test_cases,
+};
+
+kunit_test_suite(elevator_test_suite);
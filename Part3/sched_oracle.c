@@ -0,0 +1,684 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+// Offline schedule oracle for the elevator.
+//
+// Replays a request set through a copy of the scheduler in elevator.c and
+// through a parallel branch-and-bound search over every schedule the
+// single car could run, then reports the live scheduler's regret in total
+// wait, ride time and floors traveled.
+//
+// Both use the module's timing: every action (move one floor, stop to
+// unload/load, idle) takes one 2 second tick. A stop unloads every rider
+// for the floor, then boards one direction's hall queue in arrival order
+// until the first rider who does not fit MAX_WEIGHT/MAX_PASSENGERS, as
+// load_passengers() does.
+//
+// A request with start == dest is queued as UP, as issue_request() does: the
+// rider boards on their own floor and only gets off at a later stop there.
+// When the live scheduler idles with such riders still aboard and no more
+// requests to come, the module would leave them in the car for good; the
+// replay reports them and finishes their trips so the live schedule stays
+// comparable.
+//
+// The search skips stops that move nobody, moves away from every remaining
+// rider, and idling while issued riders wait. A completed search is optimal
+// over the schedules that remain, which makes it a near-optimal bound.
+//
+// Usage:
+//   ./sched_oracle [options] requests.txt   one "tick start dest type" per line
+//   ./sched_oracle [options] -g N           N random mixed up/down requests
+// Options:
+//   -f floors   building height (default MAX_FLOORS)
+//   -s seed     seed for -g (default 1)
+//   -p ticks    spread -g arrivals over this many ticks (default 2 * N)
+//   -j threads  search threads (default: online CPUs)
+//   -t seconds  search time limit (default 60); the result is then the best
+//               schedule found rather than a proven optimum
+//   -l          only print the live scheduler's totals, in the form
+//               usersim/elevator_replay prints for elevator.c itself
+
+#define MAX_FLOORS 5
+#define MAX_PASSENGERS 5
+#define MAX_WEIGHT 7
+#define MAX_REQUESTS 64
+#define MAX_TICKS 100000
+
+// Integer weights as elevator.c computes them: the lawyer's 1.5 and the
+// visitor's 0.5 truncate to 1 and 0
+static const int type_weights[] = {1, 1, 2, 0};
+
+typedef enum {WAITING, RIDING, DONE} RiderStatus;
+typedef enum {OFFLINE, IDLE, LOADING, UP, DOWN} ElevatorState;
+
+typedef struct request {
+    int arrival; // Tick of issue_request()
+    int start;
+    int dest;
+    int weight;
+} Request;
+
+// Everything the search needs to continue from a point in time
+typedef struct node {
+    int tick;
+    int floor;
+    int moves;
+    int weight;
+    int ncar;
+    int finished;
+    long wait; // Summed over boarded riders
+    long ride; // Summed over delivered riders
+    int heading; // +1/-1 once the car has moved with nothing issued, else 0
+    unsigned char status[MAX_REQUESTS];
+    int board_tick[MAX_REQUESTS];
+} Node;
+
+typedef struct result {
+    long wait;
+    long ride;
+    int floors;
+    int serviced;
+    int stranded; // Riders the live scheduler never delivered
+} Result;
+
+static Request requests[MAX_REQUESTS];
+static int num_requests;
+static int num_floors = MAX_FLOORS;
+
+// Best schedule so far, shared by the search threads. best_key orders
+// schedules by total time in system, then floors traveled
+static uint64_t best_key;
+static Result best;
+static pthread_mutex_t best_lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool out_of_time;
+static double deadline;
+
+static Node *frontier;
+static int frontier_len;
+static int next_frontier;
+static long total_nodes;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static ElevatorState request_direction(const Request *r) {
+    return (r->dest < r->start) ? DOWN : UP;
+}
+
+static uint64_t schedule_key(long time_in_system, int floors) {
+    return (uint64_t)time_in_system * 1000000 + floors;
+}
+
+//unload riders for this floor and board one direction's queue, taking a tick
+static void do_stop(Node *n, ElevatorState direction) {
+    for (int i = 0; i < num_requests; i++) {
+        if (n->status[i] == RIDING && requests[i].dest == n->floor) {
+            n->status[i] = DONE;
+            n->ride += n->tick - n->board_tick[i];
+            n->weight -= requests[i].weight;
+            n->ncar--;
+            n->finished++;
+        }
+    }
+
+    for (int i = 0; i < num_requests; i++) {
+        const Request *r = &requests[i];
+
+        if (n->status[i] != WAITING || r->arrival > n->tick || r->start != n->floor
+            || request_direction(r) != direction) {
+            continue;
+        }
+        if (n->weight + r->weight > MAX_WEIGHT || n->ncar >= MAX_PASSENGERS) {
+            break; // Elevator is full or overweight
+        }
+        n->status[i] = RIDING;
+        n->board_tick[i] = n->tick;
+        n->wait += n->tick - r->arrival;
+        n->weight += r->weight;
+        n->ncar++;
+    }
+
+    n->tick++;
+}
+
+static void do_move(Node *n, int delta) {
+    n->floor += delta;
+    n->moves++;
+    n->tick++;
+}
+
+//riders waiting on a floor, issued by tick, who travel in a direction
+static int waiting_at(const Node *n, int tick, int floor, ElevatorState direction) {
+    int count = 0;
+
+    for (int i = 0; i < num_requests; i++) {
+        if (n->status[i] == WAITING && requests[i].arrival <= tick
+            && requests[i].start == floor && request_direction(&requests[i]) == direction) {
+            count++;
+        }
+    }
+    return count;
+}
+
+//has_demand_beyond() from elevator.c over the requests issued by tick
+static bool demand_beyond(const Node *n, int tick, int floor, ElevatorState direction) {
+    for (int i = 0; i < num_requests; i++) {
+        const Request *r = &requests[i];
+        int target;
+
+        if (n->status[i] == RIDING) {
+            target = r->dest;
+        } else if (n->status[i] == WAITING && r->arrival <= tick) {
+            target = r->start;
+        } else {
+            continue;
+        }
+        if ((direction == UP && target > floor) || (direction == DOWN && target < floor)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//is there anything (issued or not) left to do past floor in a direction
+static bool any_target_beyond(const Node *n, ElevatorState direction) {
+    for (int i = 0; i < num_requests; i++) {
+        int target;
+
+        if (n->status[i] == RIDING) {
+            target = requests[i].dest;
+        } else if (n->status[i] == WAITING) {
+            target = requests[i].start;
+        } else {
+            continue;
+        }
+        if ((direction == UP && target > n->floor) || (direction == DOWN && target < n->floor)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//does a stop here unload or board anyone
+static bool stop_is_useful(const Node *n, ElevatorState direction) {
+    Node next = *n;
+
+    do_stop(&next, direction);
+    return next.ncar != n->ncar || next.finished != n->finished;
+}
+
+static bool requests_after(int tick) {
+    for (int i = 0; i < num_requests; i++) {
+        if (requests[i].arrival > tick) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//deliver whoever the live scheduler left behind, stopping wherever it helps
+static void finish_stranded(Node *n) {
+    while (n->finished < num_requests && n->tick < MAX_TICKS) {
+        if (stop_is_useful(n, UP)) {
+            do_stop(n, UP);
+        } else if (stop_is_useful(n, DOWN)) {
+            do_stop(n, DOWN);
+        } else if (any_target_beyond(n, UP)) {
+            do_move(n, 1);
+        } else if (any_target_beyond(n, DOWN)) {
+            do_move(n, -1);
+        } else {
+            break;
+        }
+    }
+}
+
+//run the request set through the scheduler in elevator.c; with finish_trips
+//unset, stop where the module would idle forever, counting the time riders
+//left behind have spent waiting or aboard so far, like elevator_replay does
+static Result run_live(bool finish_trips) {
+    Node n = {.floor = 1};
+    ElevatorState state = IDLE;
+    ElevatorState direction = UP;
+    int stranded = 0;
+
+    while (n.finished < num_requests && n.tick < MAX_TICKS) {
+        // do_stop() and do_move() end the tick, but the module decides
+        // within it, before the next tick's requests are issued
+        int now = n.tick;
+
+        // issue_request() for everything arriving this tick
+        for (int i = 0; i < num_requests; i++) {
+            if (requests[i].arrival != n.tick || state != IDLE) {
+                continue;
+            }
+            if (n.floor < requests[i].start) {
+                state = direction = UP;
+            } else if (n.floor > requests[i].start) {
+                state = direction = DOWN;
+            } else {
+                state = LOADING;
+                direction = request_direction(&requests[i]);
+            }
+        }
+
+        switch (state) {
+        case LOADING:
+            // load_passengers() turns around at the end of a run
+            if (waiting_at(&n, now, n.floor, direction) == 0 && !demand_beyond(&n, now, n.floor, direction)) {
+                direction = (direction == UP) ? DOWN : UP;
+            }
+            do_stop(&n, direction);
+
+            // decide_next_action()
+            if (demand_beyond(&n, now, n.floor, direction)) {
+                state = direction;
+            } else if (demand_beyond(&n, now, n.floor, (direction == UP) ? DOWN : UP)) {
+                state = direction = (direction == UP) ? DOWN : UP;
+            } else {
+                state = IDLE;
+            }
+            break;
+        case UP:
+        case DOWN: {
+            ElevatorState opposite = (state == UP) ? DOWN : UP;
+            bool stop = false;
+
+            do_move(&n, (state == UP) ? 1 : -1);
+            direction = state;
+
+            // should_stop()
+            for (int i = 0; i < num_requests; i++) {
+                if (n.status[i] == RIDING && requests[i].dest == n.floor) {
+                    stop = true;
+                }
+            }
+            if (waiting_at(&n, now, n.floor, direction) > 0
+                || (waiting_at(&n, now, n.floor, opposite) > 0 && !demand_beyond(&n, now, n.floor, direction))) {
+                stop = true;
+            }
+            if (stop) {
+                state = LOADING;
+            }
+            break;
+        }
+        default:
+            // Idle with riders left and nothing more to wake the car
+            if (n.finished < num_requests && !requests_after(n.tick)) {
+                stranded = num_requests - n.finished;
+                if (!finish_trips) {
+                    for (int i = 0; i < num_requests; i++) {
+                        if (n.status[i] == RIDING) {
+                            n.ride += n.tick - n.board_tick[i];
+                        } else if (n.status[i] == WAITING) {
+                            n.wait += n.tick - requests[i].arrival;
+                        }
+                    }
+                    return (Result){n.wait, n.ride, n.moves, n.finished, stranded};
+                }
+                finish_stranded(&n);
+                break;
+            }
+            n.tick++;
+            break;
+        }
+    }
+
+    if (n.finished < num_requests) {
+        fprintf(stderr, "Live scheduler did not finish within %d ticks\n", MAX_TICKS);
+        exit(1);
+    }
+    return (Result){n.wait, n.ride, n.moves, n.finished, stranded};
+}
+
+//admissible bound on the wait + ride still to come for unfinished riders
+static long lower_bound(const Node *n) {
+    long bound = n->wait + n->ride;
+
+    for (int i = 0; i < num_requests; i++) {
+        const Request *r = &requests[i];
+
+        if (n->status[i] == RIDING) {
+            bound += n->tick + abs(n->floor - r->dest) - n->board_tick[i];
+        } else if (n->status[i] == WAITING) {
+            int board = n->tick + abs(n->floor - r->start);
+
+            if (board < r->arrival) {
+                board = r->arrival;
+            }
+            bound += (board - r->arrival) + abs(r->start - r->dest) + 1;
+        }
+    }
+    return bound;
+}
+
+//record a finished schedule if it beats the best one
+static void offer_schedule(const Node *n) {
+    uint64_t key = schedule_key(n->wait + n->ride, n->moves);
+
+    pthread_mutex_lock(&best_lock);
+    if (key < best_key) {
+        __atomic_store_n(&best_key, key, __ATOMIC_RELAXED);
+        best = (Result){n->wait, n->ride, n->moves, n->finished, 0};
+    }
+    pthread_mutex_unlock(&best_lock);
+}
+
+static bool has_issued_work(const Node *n) {
+    if (n->ncar > 0) {
+        return true;
+    }
+    for (int i = 0; i < num_requests; i++) {
+        if (n->status[i] == WAITING && requests[i].arrival <= n->tick) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//tick of the next request still to be issued
+static int next_arrival(const Node *n) {
+    int next = MAX_TICKS;
+
+    for (int i = 0; i < num_requests; i++) {
+        if (n->status[i] == WAITING && requests[i].arrival > n->tick && requests[i].arrival < next) {
+            next = requests[i].arrival;
+        }
+    }
+    return next;
+}
+
+//children of a node, in the order the search tries them
+static int expand(const Node *n, Node children[5]) {
+    int count = 0;
+    bool idle = !has_issued_work(n);
+    bool up_useful = stop_is_useful(n, UP);
+    bool down_useful = stop_is_useful(n, DOWN);
+
+    // Stopping is only worth a tick if someone gets on or off, and the two
+    // directions only differ when someone boards
+    if (up_useful) {
+        children[count] = *n;
+        children[count].heading = 0;
+        do_stop(&children[count++], UP);
+    }
+    if (down_useful) {
+        children[count] = *n;
+        children[count].heading = 0;
+        do_stop(&children[count], DOWN);
+        if (!up_useful || children[count].ncar != children[count - 1].ncar
+            || memcmp(children[count].status, children[count - 1].status, num_requests)) {
+            count++;
+        }
+    }
+
+    // Never head away from every remaining rider. While nothing is issued,
+    // never turn back either: the car can reach any floor it could be on
+    // at the next arrival directly, with fewer floors traveled
+    if (n->floor < num_floors && any_target_beyond(n, UP) && !(idle && n->heading < 0)) {
+        children[count] = *n;
+        children[count].heading = idle ? 1 : 0;
+        do_move(&children[count++], 1);
+    }
+    if (n->floor > 1 && any_target_beyond(n, DOWN) && !(idle && n->heading > 0)) {
+        children[count] = *n;
+        children[count].heading = idle ? -1 : 0;
+        do_move(&children[count++], -1);
+    }
+
+    // Idling only makes sense while waiting for requests still to come,
+    // and then nothing changes until the next one, so skip straight to it
+    // rather than one tick (and one level of recursion) at a time
+    if (idle) {
+        children[count] = *n;
+        children[count].heading = 0;
+        children[count++].tick = next_arrival(n);
+    }
+
+    return count;
+}
+
+static void search(const Node *n, long *nodes) {
+    Node children[5];
+    int count;
+
+    if (++*nodes % 16384 == 0 && now_sec() > deadline) {
+        out_of_time = true;
+    }
+    if (out_of_time) {
+        return;
+    }
+
+    if (n->finished == num_requests) {
+        offer_schedule(n);
+        return;
+    }
+    if (schedule_key(lower_bound(n), n->moves) >= __atomic_load_n(&best_key, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    count = expand(n, children);
+    for (int i = 0; i < count; i++) {
+        search(&children[i], nodes);
+    }
+}
+
+//search threads take subtrees off the shared frontier until it runs out
+static void *search_worker(void *arg) {
+    long nodes = 0;
+    int i;
+
+    (void)arg;
+    while ((i = __atomic_fetch_add(&next_frontier, 1, __ATOMIC_RELAXED)) < frontier_len) {
+        search(&frontier[i], &nodes);
+    }
+
+    __atomic_fetch_add(&total_nodes, nodes, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+//expand breadth first until there is enough work to spread over threads
+static int build_frontier(int target) {
+    Node *next;
+
+    frontier = malloc(sizeof(Node));
+    if (!frontier) {
+        return -1;
+    }
+    frontier[0] = (Node){.floor = 1};
+    frontier_len = 1;
+
+    while (frontier_len > 0 && frontier_len < target) {
+        int next_len = 0;
+
+        next = malloc(sizeof(Node) * frontier_len * 5);
+        if (!next) {
+            return -1;
+        }
+        for (int i = 0; i < frontier_len; i++) {
+            if (frontier[i].finished == num_requests) {
+                offer_schedule(&frontier[i]);
+                continue;
+            }
+            next_len += expand(&frontier[i], &next[next_len]);
+        }
+        free(frontier);
+        frontier = next;
+        frontier_len = next_len;
+    }
+    return 0;
+}
+
+static int parse_requests(const char *path) {
+    FILE *f = fopen(path, "r");
+    char line[256];
+    int tick, start, dest, type;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || sscanf(line, "%d %d %d %d", &tick, &start, &dest, &type) != 4) {
+            continue;
+        }
+        if (num_requests == MAX_REQUESTS) {
+            fprintf(stderr, "At most %d requests are supported\n", MAX_REQUESTS);
+            fclose(f);
+            return -1;
+        }
+        if (tick < 0 || start < 1 || start > num_floors || dest < 1 || dest > num_floors
+            || type < 0 || type > 3) {
+            fprintf(stderr, "Invalid request: %s", line);
+            fclose(f);
+            return -1;
+        }
+        requests[num_requests++] = (Request){tick, start, dest, type_weights[type]};
+    }
+
+    fclose(f);
+    return 0;
+}
+
+static void generate_requests(int count, unsigned int seed, int spread) {
+    srand(seed);
+    for (int i = 0; i < count; i++) {
+        int start = 1 + rand() % num_floors;
+        int dest;
+
+        do {
+            dest = 1 + rand() % num_floors;
+        } while (dest == start);
+        requests[i] = (Request){rand() % spread, start, dest, type_weights[rand() % 4]};
+    }
+    num_requests = count;
+}
+
+//stable, so requests issued in the same tick keep their order in the file
+//and queue on their floor in that order, as they would in the module
+static void sort_by_arrival(void) {
+    for (int i = 1; i < num_requests; i++) {
+        Request r = requests[i];
+        int j;
+
+        for (j = i; j > 0 && requests[j - 1].arrival > r.arrival; j--) {
+            requests[j] = requests[j - 1];
+        }
+        requests[j] = r;
+    }
+}
+
+static void print_regret(const char *name, long live, long oracle) {
+    printf("%-16s %10ld %10ld %10ld %9.1f%%\n", name, live, oracle, live - oracle,
+           live ? 100.0 * (live - oracle) / live : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+    int generate = 0, spread = 0, live_only = 0, opt;
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int seed = 1;
+    double limit = 60;
+    pthread_t *workers;
+    Result live;
+    double start;
+
+    while ((opt = getopt(argc, argv, "f:g:s:p:j:t:l")) != -1) {
+        switch (opt) {
+        case 'f': num_floors = atoi(optarg); break;
+        case 'g': generate = atoi(optarg); break;
+        case 's': seed = strtoul(optarg, NULL, 10); break;
+        case 'p': spread = atoi(optarg); break;
+        case 'j': threads = atoi(optarg); break;
+        case 't': limit = atof(optarg); break;
+        case 'l': live_only = 1; break;
+        default:
+            fprintf(stderr, "Usage: %s [-f floors] [-j threads] [-t seconds] [-l] "
+                    "(requests.txt | -g count [-s seed] [-p ticks])\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (num_floors < 2 || threads < 1) {
+        fprintf(stderr, "Need at least 2 floors and 1 thread\n");
+        return 1;
+    }
+    if (generate > 0) {
+        if (generate > MAX_REQUESTS) {
+            fprintf(stderr, "At most %d requests are supported\n", MAX_REQUESTS);
+            return 1;
+        }
+        generate_requests(generate, seed, spread > 0 ? spread : 2 * generate);
+    } else if (optind < argc) {
+        if (parse_requests(argv[optind]) < 0) {
+            return 1;
+        }
+    } else {
+        fprintf(stderr, "Give a request file or -g count\n");
+        return 1;
+    }
+    if (num_requests == 0) {
+        fprintf(stderr, "No requests\n");
+        return 1;
+    }
+    sort_by_arrival();
+
+    if (live_only) {
+        live = run_live(false);
+        printf("live: wait=%ld ride=%ld floors=%d serviced=%d\n",
+               live.wait, live.ride, live.floors, live.serviced);
+        return 0;
+    }
+
+    // The live schedule is the first incumbent, so the search only keeps
+    // schedules that beat it
+    live = run_live(true);
+    best = live;
+    best_key = schedule_key(live.wait + live.ride, live.floors);
+
+    start = now_sec();
+    deadline = start + limit;
+    workers = malloc(sizeof(pthread_t) * threads);
+    if (!workers || build_frontier(threads * 64) < 0) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&workers[i], NULL, search_worker, NULL) != 0) {
+            fprintf(stderr, "Cannot start search thread %d\n", i);
+            return 1;
+        }
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    printf("%d requests, %d floors, %d threads, %ld nodes in %.2f s: %s\n\n",
+           num_requests, num_floors, threads, total_nodes, now_sec() - start,
+           out_of_time ? "time limit hit, oracle is the best schedule found"
+                       : "search complete");
+    if (live.stranded > 0) {
+        printf("Riders the live scheduler left in the car (start == dest): %d\n"
+               "Its numbers include finishing their trips afterwards\n\n", live.stranded);
+    }
+    printf("%-16s %10s %10s %10s %10s\n", "(ticks)", "live", "oracle", "regret", "regret");
+    print_regret("total wait", live.wait, best.wait);
+    print_regret("total ride", live.ride, best.ride);
+    print_regret("time in system", live.wait + live.ride, best.wait + best.ride);
+    print_regret("floors traveled", live.floors, best.floors);
+
+    free(workers);
+    free(frontier);
+    return 0;
+}
@@ -0,0 +1,24 @@
+// Runs the KUnit suite in elevator_test.c in userspace, built against
+// include/linux/usersim.h and include/kunit/test.h. Prints KTAP and exits
+// nonzero if any case fails; skipped cases (known bugs) do not fail.
+//
+// Usage: ./elevator_kunit
+//   Build with ELEVATOR_SRC=... to test another elevator.c, or with
+//   FLOORS=n to run the benchmarks on a taller building.
+
+#define CONFIG_ELEVATOR_KUNIT_TEST 1
+
+#ifndef ELEVATOR_SRC
+#define ELEVATOR_SRC "../elevator.c"
+#endif
+#include ELEVATOR_SRC
+
+int main(void) {
+    int ret = elevator_init();
+
+    if (ret) {
+        fprintf(stderr, "elevator_init failed: %d\n", ret);
+        return 1;
+    }
+    return kunit_run_suite(usersim_kunit_suite) ? 1 : 0;
+}
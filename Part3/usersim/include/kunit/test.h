@@ -0,0 +1,121 @@
+#ifndef USERSIM_KUNIT_TEST_H
+#define USERSIM_KUNIT_TEST_H
+
+// Just enough of KUnit to run elevator_test.c in userspace (see
+// elevator_kunit.c). Output follows KTAP like the in-kernel runner, so the
+// same tooling can read either. A failed assertion or kunit_skip() ends
+// the case with longjmp, which is safe here because the cases do not hold
+// locks or other resources that the exit hook does not release.
+
+#include <setjmp.h>
+#include <linux/usersim.h>
+
+struct kunit {
+    const char *name;
+    int failed;
+    int skipped;
+    char skip_reason[256];
+    jmp_buf done;
+};
+
+struct kunit_case {
+    void (*run_case)(struct kunit *test);
+    const char *name;
+    int slow;
+};
+
+struct kunit_suite {
+    const char *name;
+    int (*init)(struct kunit *test);
+    void (*exit)(struct kunit *test);
+    int (*suite_init)(struct kunit_suite *suite);
+    void (*suite_exit)(struct kunit_suite *suite);
+    struct kunit_case *test_cases;
+};
+
+#define KUNIT_CASE(fn) { .run_case = fn, .name = #fn }
+#define KUNIT_CASE_SLOW(fn) { .run_case = fn, .name = #fn, .slow = 1 }
+
+// The one suite in the translation unit, run by kunit_run_suite()
+#define kunit_test_suite(suite) static struct kunit_suite *const usersim_kunit_suite = &(suite)
+
+#define kunit_info(test, fmt, ...) printf("    # %s: " fmt, (test)->name, ##__VA_ARGS__)
+
+#define kunit_skip(test, fmt, ...) do { \
+        snprintf((test)->skip_reason, sizeof((test)->skip_reason), fmt, ##__VA_ARGS__); \
+        (test)->skipped = 1; \
+        longjmp((test)->done, 1); \
+    } while (0)
+
+static inline void *kunit_kzalloc(struct kunit *test, size_t size, int flags)
+{
+    (void)test; (void)flags;
+    return calloc(1, size); // Never freed; each run is a short-lived process
+}
+
+#define KUNIT_BINARY_CHECK(test, fatal, left, op, right) do { \
+        long long __left = (long long)(left), __right = (long long)(right); \
+        if (!(__left op __right)) { \
+            printf("    # %s: %s:%d: expected %s %s %s, but %lld vs %lld\n", (test)->name, \
+                   __FILE__, __LINE__, #left, #op, #right, __left, __right); \
+            (test)->failed = 1; \
+            if (fatal) \
+                longjmp((test)->done, 1); \
+        } \
+    } while (0)
+
+#define KUNIT_EXPECT_EQ(test, l, r) KUNIT_BINARY_CHECK(test, 0, l, ==, r)
+#define KUNIT_EXPECT_NE(test, l, r) KUNIT_BINARY_CHECK(test, 0, l, !=, r)
+#define KUNIT_EXPECT_GT(test, l, r) KUNIT_BINARY_CHECK(test, 0, l, >, r)
+#define KUNIT_EXPECT_LE(test, l, r) KUNIT_BINARY_CHECK(test, 0, l, <=, r)
+#define KUNIT_EXPECT_TRUE(test, c) KUNIT_BINARY_CHECK(test, 0, !!(c), ==, 1)
+#define KUNIT_EXPECT_FALSE(test, c) KUNIT_BINARY_CHECK(test, 0, !!(c), ==, 0)
+#define KUNIT_ASSERT_EQ(test, l, r) KUNIT_BINARY_CHECK(test, 1, l, ==, r)
+#define KUNIT_ASSERT_NOT_NULL(test, p) KUNIT_BINARY_CHECK(test, 1, (p) != NULL, ==, 1)
+
+// Returns the number of failed cases
+static inline int kunit_run_suite(struct kunit_suite *suite)
+{
+    struct kunit_case *test_case;
+    int num_cases = 0, num_failed = 0, index = 0;
+
+    for (test_case = suite->test_cases; test_case->run_case; test_case++)
+        num_cases++;
+
+    printf("KTAP version 1\n1..1\n");
+    printf("    KTAP version 1\n    # Subtest: %s\n    1..%d\n", suite->name, num_cases);
+    if (suite->suite_init && suite->suite_init(suite)) {
+        printf("not ok 1 %s\n", suite->name);
+        return 1;
+    }
+
+    for (test_case = suite->test_cases; test_case->run_case; test_case++) {
+        struct kunit test = { .name = test_case->name };
+
+        index++;
+        if (suite->init && suite->init(&test)) {
+            test.failed = 1;
+        } else {
+            if (!setjmp(test.done))
+                test_case->run_case(&test);
+            if (suite->exit)
+                suite->exit(&test);
+        }
+
+        if (test.failed) {
+            num_failed++;
+            printf("    not ok %d %s\n", index, test_case->name);
+        } else if (test.skipped) {
+            printf("    ok %d %s # SKIP %s\n", index, test_case->name, test.skip_reason);
+        } else {
+            printf("    ok %d %s\n", index, test_case->name);
+        }
+    }
+
+    if (suite->suite_exit)
+        suite->suite_exit(suite);
+    printf("%s 1 %s\n", num_failed ? "not ok" : "ok", suite->name);
+    return num_failed;
+}
+
+#endif
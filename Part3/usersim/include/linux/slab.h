@@ -0,0 +1 @@
+#include "usersim.h"
@@ -0,0 +1,13 @@
+#ifndef USERSIM_TYPES_H
+#define USERSIM_TYPES_H
+
+#include <stdint.h>
+
+// long long like the kernel's int-ll64.h, so %llu matches u64
+typedef unsigned long long __u64;
+typedef uint32_t __u32;
+typedef uint16_t __u16;
+typedef uint8_t __u8;
+typedef long long __s64;
+
+#endif
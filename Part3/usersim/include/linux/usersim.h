@@ -0,0 +1,189 @@
+#ifndef USERSIM_H
+#define USERSIM_H
+
+// Just enough of the kernel API for elevator.c to build as a userspace
+// program. The simulator is single threaded, so mutexes are no-ops, and
+// there is no kthread or proc file: callers drive the state machine
+// functions directly.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <linux/types.h>
+
+typedef __u64 u64;
+typedef __u32 u32;
+typedef __u16 u16;
+typedef __u8 u8;
+typedef __s64 s64;
+
+#define __user
+#define __weak __attribute__((weak))
+#define __init
+#define __exit
+#define MODULE_LICENSE(x)
+#define MODULE_AUTHOR(x)
+#define MODULE_DESCRIPTION(x)
+#define MODULE_VERSION(x)
+#define MODULE_PARM_DESC(name, desc)
+#define module_param(name, type, perm)
+#define module_init(fn)
+#define module_exit(fn)
+#define IS_ENABLED(option) (option + 0)
+#define static_assert _Static_assert
+
+#define KERN_INFO ""
+#define printk printf
+#define pr_info printf
+#define pr_err printf
+
+#define GFP_KERNEL 0
+#define kmalloc(size, flags) malloc(size)
+#define kzalloc(size, flags) calloc(1, size)
+#define kfree free
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define div64_u64(a, b) ((a) / (b))
+#define struct_size(p, member, n) (sizeof(*(p)) + sizeof((p)->member[0]) * (n))
+#define container_of(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+
+static inline int scnprintf(char *buf, size_t size, const char *fmt, ...)
+{
+    va_list args;
+    int len;
+
+    if (size == 0)
+        return 0;
+    va_start(args, fmt);
+    len = vsnprintf(buf, size, fmt, args);
+    va_end(args);
+    return len >= (int)size ? (int)size - 1 : len;
+}
+
+static inline int sysfs_streq(const char *a, const char *b)
+{
+    return strcmp(a, b) == 0;
+}
+
+struct mutex { int unused; };
+static inline void mutex_init(struct mutex *lock) { (void)lock; }
+static inline void mutex_destroy(struct mutex *lock) { (void)lock; }
+static inline void mutex_lock(struct mutex *lock) { (void)lock; }
+static inline int mutex_trylock(struct mutex *lock) { (void)lock; return 1; }
+static inline void mutex_unlock(struct mutex *lock) { (void)lock; }
+
+struct list_head { struct list_head *next, *prev; };
+#define LIST_HEAD_INIT(name) { &(name), &(name) }
+static inline void INIT_LIST_HEAD(struct list_head *list) { list->next = list->prev = list; }
+static inline int list_empty(const struct list_head *head) { return head->next == head; }
+static inline void list_add_tail(struct list_head *entry, struct list_head *head)
+{
+    entry->prev = head->prev;
+    entry->next = head;
+    head->prev->next = entry;
+    head->prev = entry;
+}
+static inline void list_del(struct list_head *entry)
+{
+    entry->next->prev = entry->prev;
+    entry->prev->next = entry->next;
+}
+static inline void list_move_tail(struct list_head *entry, struct list_head *head)
+{
+    list_del(entry);
+    list_add_tail(entry, head);
+}
+static inline void list_splice_tail_init(struct list_head *list, struct list_head *head)
+{
+    if (list_empty(list))
+        return;
+    list->next->prev = head->prev;
+    head->prev->next = list->next;
+    list->prev->next = head;
+    head->prev = list->prev;
+    INIT_LIST_HEAD(list);
+}
+#define list_entry(ptr, type, member) container_of(ptr, type, member)
+#define list_first_entry(ptr, type, member) list_entry((ptr)->next, type, member)
+#define list_for_each_entry(pos, head, member) \
+    for (pos = list_entry((head)->next, __typeof__(*pos), member); &pos->member != (head); \
+         pos = list_entry(pos->member.next, __typeof__(*pos), member))
+#define list_for_each_entry_safe(pos, n, head, member) \
+    for (pos = list_entry((head)->next, __typeof__(*pos), member), \
+         n = list_entry(pos->member.next, __typeof__(*pos), member); &pos->member != (head); \
+         pos = n, n = list_entry(n->member.next, __typeof__(*n), member))
+
+typedef struct { long long counter; } atomic64_t;
+#define atomic64_read(v) ((v)->counter)
+#define atomic64_set(v, i) ((v)->counter = (i))
+#define atomic64_inc(v) ((v)->counter++)
+#define atomic64_add(i, v) ((v)->counter += (i))
+
+struct static_key_false { int enabled; };
+#define DEFINE_STATIC_KEY_FALSE(name) struct static_key_false name
+#define static_branch_unlikely(key) ((key)->enabled)
+#define static_key_enabled(key) ((key)->enabled)
+#define static_branch_enable(key) ((key)->enabled = 1)
+#define static_branch_disable(key) ((key)->enabled = 0)
+
+static inline u64 ktime_get_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+struct task_struct;
+struct file;
+struct inode;
+struct proc_dir_entry;
+struct proc_ops {
+    void *proc_open, *proc_release, *proc_read, *proc_write, *proc_mmap, *proc_lseek;
+};
+static inline struct proc_dir_entry *proc_create(const char *name, int mode, void *parent,
+                                                 const struct proc_ops *ops)
+{
+    (void)name; (void)mode; (void)parent; (void)ops;
+    return (struct proc_dir_entry *)1;
+}
+static inline void proc_remove(struct proc_dir_entry *entry) { (void)entry; }
+static inline ssize_t simple_read_from_buffer(void *to, size_t count, loff_t *ppos,
+                                              const void *from, size_t available)
+{
+    size_t n;
+
+    if (*ppos < 0 || (size_t)*ppos >= available)
+        return 0;
+    n = min(available - *ppos, count);
+    memcpy(to, (const char *)from + *ppos, n);
+    *ppos += n;
+    return n;
+}
+static inline unsigned long copy_from_user(void *to, const void *from, unsigned long n)
+{
+    memcpy(to, from, n);
+    return 0;
+}
+
+static inline void msleep(unsigned int ms) { (void)ms; }
+static inline int kthread_should_stop(void) { return 0; }
+static inline int kthread_stop(struct task_struct *task) { (void)task; return 0; }
+static inline void wake_up_process(struct task_struct *task) { (void)task; }
+#define kthread_create(fn, data, name) ((struct task_struct *)NULL)
+#define kthread_run(fn, data, name) ((struct task_struct *)NULL)
+#define IS_ERR(ptr) 0
+#define PTR_ERR(ptr) 0
+
+// Defined by syscalls.c in the kernel
+int (*STUB_start_elevator)(void);
+int (*STUB_issue_request)(int, int, int);
+int (*STUB_stop_elevator)(void);
+
+#endif